@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Physics/CollisionDetection.h"
+#include "Physics/Force.h"
+#include "Physics/World.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Headless benchmarks of the physics library, no window is opened.
+//   bench              runs all of them
+//   bench rays fluid   runs the named ones
+// Every run prints its timings with the numbers that check the result, so a
+// speedup that changes the answer shows up next to it.
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr float PI = 3.14159265f;
+
+    double MillisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // One thread, then every hardware thread when there are more
+    std::vector<int> GetThreadCounts() {
+        const int hardwareCount = static_cast<int>(std::thread::hardware_concurrency());
+        if (hardwareCount > 1) return {1, hardwareCount};
+        return {1};
+    }
+
+    std::vector<Vec2> GetRegularPolygon(int vertexCount, float radius) {
+        std::vector<Vec2> vertices;
+        for (int i = 0; i < vertexCount; i++) {
+            const float angle = 2.0f * PI * i / vertexCount;
+            vertices.push_back(Vec2(std::cos(angle), std::sin(angle)) * radius);
+        }
+        return vertices;
+    }
+
+    // Reference for the hill climbing: every vertex of b against every edge of a
+    float GetFullScanSeparation(const PolygonShape& a, const PolygonShape& b) {
+        float separation = -std::numeric_limits<float>::max();
+        for (int i = 0; i < static_cast<int>(a.worldVertices.size()); i++) {
+            const Vec2 normal = a.GetNormal(i);
+            float minSeparation = std::numeric_limits<float>::max();
+            for (const Vec2& vertex: b.worldVertices)
+                minSeparation = std::min(minSeparation, (vertex - a.worldVertices[i]).Dot(normal));
+            separation = std::max(separation, minSeparation);
+        }
+        return separation;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // SAT of two regular polygons, one turning a little every frame so the
+    // support searches start next to last frame's answer, as in a simulation.
+    ///////////////////////////////////////////////////////////////////////////////
+    void BenchSat() {
+        printf("== sat: polygon vs polygon, hill climbing against a full scan ==\n");
+        constexpr int POSES = 256;
+        constexpr int REPEATS = 200;
+
+        for (int vertexCount: {4, 8, 16, 32, 64}) {
+            const PolygonShape shape(GetRegularPolygon(vertexCount, 50.0f));
+            PolygonShape a = shape;
+            a.UpdateVertices(0.1f, Vec2(0.0f, 0.0f));
+            std::vector<PolygonShape> poses(POSES, shape);
+            for (int p = 0; p < POSES; p++)
+                poses[p].UpdateVertices(0.01f * p, Vec2(95.0f, 10.0f));
+
+            float maxDifference = 0.0f;
+            for (const PolygonShape& b: poses) {
+                int edge;
+                Vec2 support;
+                int start = 0;
+                maxDifference = std::max(maxDifference, std::abs(a.FindMinSeparation(b, edge, support, start) - GetFullScanSeparation(a, b)));
+            }
+
+            volatile float sink = 0.0f;
+            int abStart = 0, baStart = 0;
+            auto start = Clock::now();
+            for (int r = 0; r < REPEATS; r++) {
+                for (const PolygonShape& b: poses) {
+                    int edge;
+                    Vec2 support;
+                    sink = sink + a.FindMinSeparation(b, edge, support, abStart) + b.FindMinSeparation(a, edge, support, baStart);
+                }
+            }
+            const double climbNs = MillisecondsSince(start) * 1e6 / (REPEATS * POSES);
+
+            start = Clock::now();
+            for (int r = 0; r < REPEATS; r++) {
+                for (const PolygonShape& b: poses)
+                    sink = sink + GetFullScanSeparation(a, b) + GetFullScanSeparation(b, a);
+            }
+            const double scanNs = MillisecondsSince(start) * 1e6 / (REPEATS * POSES);
+
+            // Whole narrowphase, vertex update of the turning body included
+            Body* bodyA = new Body(shape, 0.0f, 0.0f, 1.0f);
+            Body* bodyB = new Body(shape, 95.0f, 10.0f, 1.0f);
+            bodyA->shape->UpdateVertices(0.1f, bodyA->position);
+            std::vector<Contact> contacts;
+            start = Clock::now();
+            for (int r = 0; r < REPEATS; r++) {
+                for (int p = 0; p < POSES; p++) {
+                    bodyB->shape->UpdateVertices(0.01f * p, bodyB->position);
+                    contacts.clear();
+                    CollisionDetection::IsCollidingPolygonPolygon(bodyA, bodyB, contacts);
+                }
+            }
+            const double narrowphaseNs = MillisecondsSince(start) * 1e6 / (REPEATS * POSES);
+            CollisionDetection::ClearCache(bodyA);
+            CollisionDetection::ClearCache(bodyB);
+            delete bodyA;
+            delete bodyB;
+
+            printf("  %2d vertices: hill climbing %7.1f ns, full scan %8.1f ns (%5.1fx), narrowphase %7.1f ns, max separation difference %.2g\n",
+                   vertexCount, climbNs, scanNs, scanNs / climbNs, narrowphaseNs, maxDifference);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // Random overlapping box pairs through the box narrowphase and the general
+    // polygon one, which must give the same manifolds.
+    ///////////////////////////////////////////////////////////////////////////////
+    void BenchBoxManifolds() {
+        printf("== boxes: box vs box manifolds against the polygon path ==\n");
+        constexpr int PAIRS = 2000;
+        constexpr int REPEATS = 20;
+        constexpr float TOLERANCE = 0.01f;   // Pixels
+
+        std::mt19937 random(27);
+        std::uniform_real_distribution<float> size(10.0f, 80.0f);
+        std::uniform_real_distribution<float> offset(-60.0f, 60.0f);
+        std::uniform_real_distribution<float> angle(-PI, PI);
+
+        std::vector<Body*> bodies;
+        for (int i = 0; i < PAIRS; i++) {
+            Body* a = new Body(BoxShape(size(random), size(random)), 0.0f, 0.0f, 1.0f);
+            Body* b = new Body(BoxShape(size(random), size(random)), offset(random), offset(random), 1.0f);
+            a->rotation = angle(random);
+            b->rotation = angle(random);
+            a->shape->UpdateVertices(a->rotation, a->position);
+            b->shape->UpdateVertices(b->rotation, b->position);
+            bodies.push_back(a);
+            bodies.push_back(b);
+        }
+
+        int collidingCount = 0, mismatchCount = 0;
+        float maxDifference = 0.0f;
+        std::vector<Contact> boxContacts, polygonContacts;
+        for (int i = 0; i < PAIRS; i++) {
+            Body* a = bodies[2 * i];
+            Body* b = bodies[2 * i + 1];
+            boxContacts.clear();
+            polygonContacts.clear();
+            const bool isBoxHit = CollisionDetection::IsCollidingBoxBox(a, b, boxContacts);
+            const bool isPolygonHit = CollisionDetection::IsCollidingPolygonPolygon(a, b, polygonContacts);
+            collidingCount += isPolygonHit;
+            if (isBoxHit != isPolygonHit || boxContacts.size() != polygonContacts.size()) {
+                mismatchCount++;
+                continue;
+            }
+
+            float difference = 0.0f;
+            for (size_t c = 0; c < boxContacts.size(); c++) {
+                const Contact& box = boxContacts[c];
+                const Contact& polygon = polygonContacts[c];
+                difference = std::max({difference, (box.start - polygon.start).Magnitude(), (box.end - polygon.end).Magnitude(),
+                                       (box.normal - polygon.normal).Magnitude(), std::abs(box.depth - polygon.depth)});
+            }
+            maxDifference = std::max(maxDifference, difference);
+            if (difference > TOLERANCE) mismatchCount++;
+        }
+
+        std::vector<Contact> contacts;
+        auto start = Clock::now();
+        for (int r = 0; r < REPEATS; r++) {
+            for (int i = 0; i < PAIRS; i++) {
+                contacts.clear();
+                CollisionDetection::IsCollidingBoxBox(bodies[2 * i], bodies[2 * i + 1], contacts);
+            }
+        }
+        const double boxNs = MillisecondsSince(start) * 1e6 / (REPEATS * PAIRS);
+
+        start = Clock::now();
+        for (int r = 0; r < REPEATS; r++) {
+            for (int i = 0; i < PAIRS; i++) {
+                contacts.clear();
+                CollisionDetection::IsCollidingPolygonPolygon(bodies[2 * i], bodies[2 * i + 1], contacts);
+            }
+        }
+        const double polygonNs = MillisecondsSince(start) * 1e6 / (REPEATS * PAIRS);
+
+        for (Body* body: bodies) {
+            CollisionDetection::ClearCache(body);
+            delete body;
+        }
+        printf("  %d pairs, %d colliding: %d mismatched manifolds, max difference %.2g px\n", PAIRS, collidingCount, mismatchCount, maxDifference);
+        printf("  box path %.1f ns, polygon path %.1f ns (%.1fx)\n", boxNs, polygonNs, polygonNs / boxNs);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // Fast small balls fired at a thin wall through a pile of boxes, with and
+    // without speculative contacts.
+    ///////////////////////////////////////////////////////////////////////////////
+    void BenchSpeculative() {
+        printf("== speculative: fast balls against a thin wall, discrete against speculative contacts ==\n");
+        constexpr int STEPS = 120;
+
+        for (float margin: {0.0f, 100.0f}) {
+            World world(-9.8f);
+            world.SetSpeculativeMargin(margin);
+            world.AddBody(new Body(BoxShape(1600, 40), 800, 1000, 0.0f));
+            world.AddBody(new Body(BoxShape(6, 900), 1200, 530, 0.0f));
+            for (int i = 0; i < 400; i++)
+                world.AddBody(new Body(BoxShape(20, 20), 100 + (i % 20) * 25, 500 + (i / 20) * 22, 1.0f));
+
+            std::vector<Body*> balls;
+            for (int i = 0; i < 100; i++) {
+                Body* ball = new Body(CircleShape(3), 900, 120 + i * 7, 1.0f);
+                ball->velocity = Vec2(4000.0f, 0.0f);
+                ball->restitution = 0.0f;
+                world.AddBody(ball);
+                balls.push_back(ball);
+            }
+
+            const auto start = Clock::now();
+            for (int s = 0; s < STEPS; s++)
+                world.Update(1.0f / 60.0f);
+            const double ms = MillisecondsSince(start) / STEPS;
+
+            int throughCount = 0;
+            for (const Body* ball: balls)
+                throughCount += ball->position.x > 1200.0f;
+            printf("  margin %5.1f: %.2f ms/step, %d of %zu balls through the wall\n", margin, ms, throughCount, balls.size());
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // A fan of 10k rays through 5k bodies, one cast at a time and batched in
+    // packets on one and on every hardware thread.
+    ///////////////////////////////////////////////////////////////////////////////
+    void BenchRays() {
+        printf("== rays: 10000 rays against 5000 bodies ==\n");
+        constexpr int RAYS = 10000;
+        constexpr int BODIES = 5000;
+
+        std::mt19937 random(37);
+        std::uniform_real_distribution<float> coordinate(-2000.0f, 2000.0f);
+        std::uniform_real_distribution<float> size(4.0f, 30.0f);
+        World world(0.0f);
+        for (int i = 0; i < BODIES; i++) {
+            const float x = coordinate(random);
+            const float y = coordinate(random);
+            const float mass = i % 2 ? 1.0f : 0.0f;
+            if (i % 3 == 0) world.AddBody(new Body(BoxShape(size(random), size(random)), x, y, mass));
+            else world.AddBody(new Body(CircleShape(size(random) * 0.5f), x, y, mass));
+        }
+        world.Update(1.0f / 60.0f);
+
+        std::vector<RayCastInput> rays(RAYS);
+        for (int i = 0; i < RAYS; i++) {
+            const float angle = 2.0f * PI * i / RAYS;
+            rays[i].start = Vec2(0.0f, 0.0f);
+            rays[i].end = Vec2(std::cos(angle), std::sin(angle)) * 2500.0f;
+        }
+
+        std::vector<RayCastHit> singleHits(RAYS);
+        auto start = Clock::now();
+        for (int i = 0; i < RAYS; i++) {
+            if (!world.RayCast(rays[i].start, rays[i].end, singleHits[i])) singleHits[i] = RayCastHit();
+        }
+        const double singleMs = MillisecondsSince(start);
+
+        std::vector<RayCastHit> batchHits;
+        for (int threadCount: GetThreadCounts()) {
+            start = Clock::now();
+            world.RayCastBatch(rays, batchHits, threadCount);
+            const double batchMs = MillisecondsSince(start);
+
+            int hitCount = 0, mismatchCount = 0;
+            for (int i = 0; i < RAYS; i++) {
+                hitCount += batchHits[i].body != nullptr;
+                if (batchHits[i].body != singleHits[i].body || std::abs(batchHits[i].fraction - singleHits[i].fraction) > 1e-4f)
+                    mismatchCount++;
+            }
+            printf("  single casts %.2f ms, batch on %d thread%s %.2f ms (%.1fx), %d hits, %d differ from the single casts\n",
+                   singleMs, threadCount, threadCount > 1 ? "s" : "", batchMs, singleMs / batchMs, hitCount, mismatchCount);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // Gravity of a disc of bodies: the Barnes-Hut tree for a few opening angles
+    // and the tiled all-pairs kernel, against the pairwise force.
+    ///////////////////////////////////////////////////////////////////////////////
+    void BenchGravity() {
+        printf("== gravity: Barnes-Hut and tiled all-pairs against the pairwise force ==\n");
+        constexpr float G = 1000.0f;
+        constexpr float MIN_DISTANCE = 25.0f;
+        constexpr float MAX_DISTANCE = 1e12f;
+
+        for (int count: {500, 2000, 8000}) {
+            std::mt19937 random(42);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::vector<Body*> bodies;
+            std::vector<float> x(count), y(count), mass(count);
+            for (int i = 0; i < count; i++) {
+                const float radius = 1000.0f * std::sqrt(unit(random));
+                const float angle = 2.0f * PI * unit(random);
+                bodies.push_back(new Body(CircleShape(2), radius * std::cos(angle), radius * std::sin(angle), 1.0f + 9.0f * unit(random)));
+                x[i] = bodies[i]->position.x;
+                y[i] = bodies[i]->position.y;
+                mass[i] = bodies[i]->mass;
+            }
+
+            std::vector<Vec2> reference(count);
+            auto start = Clock::now();
+            for (int i = 0; i < count; i++) {
+                for (int j = i + 1; j < count; j++) {
+                    const Vec2 force = Force::GenerateGravitationalForce(*bodies[i], *bodies[j], G, MIN_DISTANCE, MAX_DISTANCE);
+                    reference[i] += force;
+                    reference[j] -= force;
+                }
+            }
+            const double pairwiseMs = MillisecondsSince(start);
+            double referenceSquared = 0.0;
+            for (const Vec2& force: reference)
+                referenceSquared += force.MagnitudeSquared();
+
+            // Relative RMS error of the forces
+            auto getError = [&](const std::function<Vec2(int)>& getForce) {
+                double errorSquared = 0.0;
+                for (int i = 0; i < count; i++)
+                    errorSquared += (getForce(i) - reference[i]).MagnitudeSquared();
+                return std::sqrt(errorSquared / referenceSquared);
+            };
+
+            printf("  %d bodies: pairwise %.2f ms\n", count, pairwiseMs);
+            for (float theta: {0.3f, 0.5f, 0.8f}) {
+                for (Body* body: bodies)
+                    body->netForce = Vec2();
+                start = Clock::now();
+                Force::ApplyGravitationalForces(bodies, G, MIN_DISTANCE, MAX_DISTANCE, theta);
+                const double treeMs = MillisecondsSince(start);
+                printf("    Barnes-Hut theta %.1f: %7.2f ms (%5.1fx), error %.2e\n", theta, treeMs, pairwiseMs / treeMs,
+                       getError([&](int i) { return bodies[i]->netForce; }));
+            }
+
+            std::vector<float> forceX(count), forceY(count);
+            for (int threadCount: GetThreadCounts()) {
+                start = Clock::now();
+                Force::GenerateGravitationalForces(x.data(), y.data(), mass.data(), count, G, MIN_DISTANCE, MAX_DISTANCE,
+                                                   forceX.data(), forceY.data(), threadCount);
+                const double tiledMs = MillisecondsSince(start);
+                printf("    tiled on %2d thread%s:  %7.2f ms (%5.1fx), error %.2e\n", threadCount, threadCount > 1 ? "s" : " ", tiledMs,
+                       pairwiseMs / tiledMs, getError([&](int i) { return Vec2(forceX[i], forceY[i]); }));
+            }
+
+            for (Body* body: bodies)
+                delete body;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // A pool of fluid settling in a box, on one and on every hardware thread.
+    ///////////////////////////////////////////////////////////////////////////////
+    void BenchFluid() {
+        printf("== fluid: particle throughput of a settling pool ==\n");
+        constexpr int STEPS = 60;
+
+        for (int threadCount: GetThreadCounts()) {
+            World world(-9.8f);
+            world.AddBody(new Body(BoxShape(1700, 40), 850, 1020, 0.0f));
+            world.AddBody(new Body(BoxShape(40, 1000), -20, 500, 0.0f));
+            world.AddBody(new Body(BoxShape(40, 1000), 1720, 500, 0.0f));
+            FluidSystem* fluid = new FluidSystem(16.0f, 1.0f);
+            fluid->threadCount = threadCount;
+            fluid->AddBlock(AABB(Vec2(0, 200), Vec2(1700, 1000)));
+            world.AddFluidSystem(fluid);
+
+            const auto start = Clock::now();
+            for (int s = 0; s < STEPS; s++)
+                world.Update(1.0f / 60.0f);
+            const double ms = MillisecondsSince(start) / STEPS;
+
+            int escapedCount = 0;
+            for (int i = 0; i < fluid->GetParticleCount(); i++)
+                escapedCount += fluid->x[i] < 0.0f || fluid->x[i] > 1700.0f || fluid->y[i] > 1000.0f;
+            printf("  %d particles on %2d thread%s: %.2f ms/step, %.2f M particle substeps/s, %d outside the box\n",
+                   fluid->GetParticleCount(), threadCount, threadCount > 1 ? "s" : " ", ms,
+                   fluid->GetParticleCount() * fluid->substeps / ms * 1e-3, escapedCount);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // A 100 link chain falling from the horizontal under its own weight, with
+    // the iterative and the direct joint solvers.
+    ///////////////////////////////////////////////////////////////////////////////
+    void BenchChain() {
+        printf("== chain: 100 links, iterative against direct joint solver ==\n");
+        constexpr int LINKS = 100;
+        constexpr int STEPS = 300;
+
+        for (bool isDirect: {false, true}) {
+            World world(-9.8f);
+            world.SetDirectJointSolver(isDirect);
+            Body* anchor = new Body(CircleShape(5), 100, 100, 0.0f);
+            world.AddBody(anchor);
+            Body* previous = anchor;
+            for (int i = 1; i <= LINKS; i++) {
+                Body* link = new Body(CircleShape(4), 100 + i * 10.0f, 100, 1.0f);
+                link->groupIndex = -1;
+                world.AddBody(link);
+                world.AddConstraint(new JointConstraint(previous, link, Vec2(95 + i * 10.0f, 100)));
+                previous = link;
+            }
+
+            const auto start = Clock::now();
+            for (int s = 0; s < STEPS; s++)
+                world.Update(1.0f / 60.0f);
+            const double ms = MillisecondsSince(start) / STEPS;
+
+            float maxGap = 0.0f, totalGap = 0.0f;
+            for (const Constraint* constraint: world.GetConstraints()) {
+                const float gap = (constraint->b->GetWorldPoint(constraint->bPoint) - constraint->a->GetWorldPoint(constraint->aPoint)).Magnitude();
+                maxGap = std::max(maxGap, gap);
+                totalGap += gap;
+            }
+            printf("  %s: %.3f ms/step, max gap %.3f px, total stretch %.1f px, anchor to end %.1f px for a %d px chain\n",
+                   isDirect ? "direct   " : "iterative", ms, maxGap, totalGap, (previous->position - anchor->position).Magnitude(), LINKS * 10);
+        }
+    }
+
+    struct Benchmark {
+        const char* name;
+        void (*run)();
+    };
+
+    const Benchmark BENCHMARKS[] = {
+        {"sat", BenchSat},
+        {"boxes", BenchBoxManifolds},
+        {"speculative", BenchSpeculative},
+        {"rays", BenchRays},
+        {"gravity", BenchGravity},
+        {"fluid", BenchFluid},
+        {"chain", BenchChain},
+    };
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const bool isKnown = std::any_of(std::begin(BENCHMARKS), std::end(BENCHMARKS),
+                                         [&](const Benchmark& benchmark) { return std::strcmp(argv[i], benchmark.name) == 0; });
+        if (isKnown) continue;
+
+        printf("Unknown benchmark %s, the benchmarks are:", argv[i]);
+        for (const Benchmark& benchmark: BENCHMARKS)
+            printf(" %s", benchmark.name);
+        printf("\n");
+        return 1;
+    }
+
+    for (const Benchmark& benchmark: BENCHMARKS) {
+        bool isSelected = argc == 1;
+        for (int i = 1; i < argc; i++)
+            isSelected = isSelected || std::strcmp(argv[i], benchmark.name) == 0;
+        if (isSelected) benchmark.run();
+    }
+    return 0;
+}
@@ -60,6 +60,19 @@ void Application::Input() {
                     box->restitution = 0.2;
                     world->AddBody(box);
                 }
+                if (event.button.button == SDL_BUTTON_MIDDLE) {
+                    // Pick the body under the mouse and remove it, the walls and floor stay
+                    int x, y;
+                    SDL_GetMouseState(&x, &y);
+                    Body* picked[4];
+                    int count = world->QueryPoint(Vec2(x, y), picked, 4);
+                    for (int i = 0; i < count; i++) {
+                        if (picked[i]->IsStatic()) continue;
+                        world->RemoveBody(picked[i]);
+                        delete picked[i];
+                        break;
+                    }
+                }
                 break;
 			default: break;
         }
@@ -123,11 +136,35 @@ void Application::Render() {
 					                      body->texture);
 				break;
 			}
+			case ShapeType::CAPSULE: {
+				CapsuleShape *capsule = dynamic_cast<CapsuleShape *>(body->shape);
+				if (Debug || !body->texture) {
+					const Vec2 side = (capsule->worldPoint2 - capsule->worldPoint1).Normal() * capsule->radius;
+					const Vec2 a = capsule->worldPoint1 + side, b = capsule->worldPoint2 + side;
+					const Vec2 c = capsule->worldPoint1 - side, d = capsule->worldPoint2 - side;
+					Graphics::DrawLine(a.x, a.y, b.x, b.y, color);
+					Graphics::DrawLine(c.x, c.y, d.x, d.y, color);
+					Graphics::DrawCircle(capsule->worldPoint1.x, capsule->worldPoint1.y, capsule->radius, body->rotation, color);
+					Graphics::DrawCircle(capsule->worldPoint2.x, capsule->worldPoint2.y, capsule->radius, body->rotation, color);
+				} else
+					Graphics::DrawTexture(body->position.x, body->position.y, capsule->radius * 2,
+					                      capsule->length + capsule->radius * 2, body->rotation, body->texture);
+				break;
+			}
 			case ShapeType::POLYGON: {
 				PolygonShape *polygon = dynamic_cast<PolygonShape *>(body->shape);
 				Graphics::DrawPolygon(body->position.x, body->position.y, polygon->worldVertices, color);
 				break;
 			}
+			case ShapeType::CHAIN: {
+				ChainShape *chain = dynamic_cast<ChainShape *>(body->shape);
+				for (int i = 0; i < chain->GetSegmentCount(); i++) {
+					const Vec2 &a = chain->worldVertices[i];
+					const Vec2 &b = chain->worldVertices[(i + 1) % chain->worldVertices.size()];
+					Graphics::DrawLine(a.x, a.y, b.x, b.y, color);
+				}
+				break;
+			}
 			default:
 				break;
 		}
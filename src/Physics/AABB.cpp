@@ -0,0 +1,62 @@
+#include "AABB.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+AABB::AABB(const Vec2& min, const Vec2& max) : min(min), max(max) {}
+
+bool AABB::Overlaps(const AABB& other) const {
+    return min.x <= other.max.x && max.x >= other.min.x &&
+           min.y <= other.max.y && max.y >= other.min.y;
+}
+
+bool AABB::Contains(const Vec2& point) const {
+    return point.x >= min.x && point.x <= max.x &&
+           point.y >= min.y && point.y <= max.y;
+}
+
+bool AABB::Contains(const AABB& other) const {
+    return other.min.x >= min.x && other.max.x <= max.x &&
+           other.min.y >= min.y && other.max.y <= max.y;
+}
+
+AABB AABB::Union(const AABB& other) const {
+    return AABB(Vec2(std::min(min.x, other.min.x), std::min(min.y, other.min.y)),
+                Vec2(std::max(max.x, other.max.x), std::max(max.y, other.max.y)));
+}
+
+bool AABB::IntersectsRay(const Vec2& start, const Vec2& delta, float maxFraction) const {
+    float tMin = 0.0f;
+    float tMax = maxFraction;
+
+    const float starts[2] = {start.x, start.y};
+    const float deltas[2] = {delta.x, delta.y};
+    const float mins[2] = {min.x, min.y};
+    const float maxs[2] = {max.x, max.y};
+    for (int i = 0; i < 2; i++) {
+        // Parallel to the slab, it has to start inside it
+        if (std::abs(deltas[i]) < 1e-9f) {
+            if (starts[i] < mins[i] || starts[i] > maxs[i]) return false;
+            continue;
+        }
+
+        const float inverseDelta = 1.0f / deltas[i];
+        float t1 = (mins[i] - starts[i]) * inverseDelta;
+        float t2 = (maxs[i] - starts[i]) * inverseDelta;
+        if (t1 > t2) std::swap(t1, t2);
+
+        tMin = std::max(tMin, t1);
+        tMax = std::min(tMax, t2);
+        if (tMin > tMax) return false;
+    }
+    return true;
+}
+
+Vec2 AABB::GetCenter() const {
+    return (min + max) * 0.5f;
+}
+
+float AABB::GetPerimeter() const {
+    return 2.0f * ((max.x - min.x) + (max.y - min.y));
+}
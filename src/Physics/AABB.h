@@ -0,0 +1,28 @@
+#ifndef AABB_H
+#define AABB_H
+
+#pragma once
+
+#include "Math/Vec2.h"
+
+// Axis aligned bounding box in world space
+struct AABB {
+    Vec2 min{};
+    Vec2 max{};
+
+    AABB() = default;
+    AABB(const Vec2& min, const Vec2& max);
+
+    bool Overlaps(const AABB& other) const;
+    bool Contains(const Vec2& point) const;
+    bool Contains(const AABB& other) const;
+    AABB Union(const AABB& other) const;
+
+    // Whether the ray start + delta * t enters the box for some t in [0, maxFraction] (slab test)
+    bool IntersectsRay(const Vec2& start, const Vec2& delta, float maxFraction) const;
+
+    Vec2 GetCenter() const;
+    float GetPerimeter() const;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+void BVH::Build(const std::vector<AABB>& boxes) {
+    Clear();
+    if (boxes.empty()) return;
+
+    itemBoxes = boxes;
+    indices.resize(boxes.size());
+    for (int i = 0; i < indices.size(); i++)
+        indices[i] = i;
+
+    nodes.reserve(2 * boxes.size() / MAX_LEAF_ITEMS + 1);
+    BuildNode(0, static_cast<int>(indices.size()), 0);
+}
+
+void BVH::Clear() {
+    nodes.clear();
+    indices.clear();
+    itemBoxes.clear();
+}
+
+////////////////////////////////////////////////////////////
+// Top down build, splitting the items at the median of the
+// longest axis of their centers
+////////////////////////////////////////////////////////////
+int BVH::BuildNode(int start, int count, int depth) {
+    const int nodeIndex = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+
+    AABB box = itemBoxes[indices[start]];
+    AABB centers(box.GetCenter(), box.GetCenter());
+    for (int i = start + 1; i < start + count; i++) {
+        const AABB& itemBox = itemBoxes[indices[i]];
+        box = box.Union(itemBox);
+        centers = centers.Union(AABB(itemBox.GetCenter(), itemBox.GetCenter()));
+    }
+    nodes[nodeIndex].box = box;
+
+    // The depth limit keeps the query stack bounded, deep leaves just hold more items
+    if (count <= MAX_LEAF_ITEMS || depth >= MAX_DEPTH - 2) {
+        nodes[nodeIndex].start = start;
+        nodes[nodeIndex].count = count;
+        return nodeIndex;
+    }
+
+    const bool splitX = (centers.max.x - centers.min.x) >= (centers.max.y - centers.min.y);
+    const int half = count / 2;
+    std::nth_element(indices.begin() + start, indices.begin() + start + half, indices.begin() + start + count,
+        [this, splitX](int a, int b) {
+            const Vec2 ca = itemBoxes[a].GetCenter();
+            const Vec2 cb = itemBoxes[b].GetCenter();
+            return splitX ? ca.x < cb.x : ca.y < cb.y;
+        });
+
+    const int left = BuildNode(start, half, depth + 1);
+    const int right = BuildNode(start + half, count - half, depth + 1);
+    nodes[nodeIndex].left = left;
+    nodes[nodeIndex].right = right;
+    return nodeIndex;
+}
+
+BVH::RayPacket BVH::MakeRayPacket(const Vec2* starts, const Vec2* ends) {
+    // Near zero deltas get a huge finite inverse instead of infinity, which keeps the
+    // slab test free of NaNs and branches for rays parallel to an axis
+    auto inverse = [](float delta) {
+        return 1.0f / (std::abs(delta) < 1e-9f ? std::copysign(1e-9f, delta) : delta);
+    };
+
+    RayPacket packet;
+    for (int i = 0; i < PACKET_SIZE; i++) {
+        packet.startX[i] = starts[i].x;
+        packet.startY[i] = starts[i].y;
+        packet.inverseDeltaX[i] = inverse(ends[i].x - starts[i].x);
+        packet.inverseDeltaY[i] = inverse(ends[i].y - starts[i].y);
+    }
+    return packet;
+}
+
+////////////////////////////////////////////////////////////
+// Slab test of every ray of the packet against the box.
+// A fixed width loop without branches, so the compiler
+// can vectorize it on any target without intrinsics
+////////////////////////////////////////////////////////////
+int BVH::IntersectsPacket(const AABB& box, const RayPacket& packet, const float* maxFractions) {
+    int isCrossing[PACKET_SIZE];
+    for (int i = 0; i < PACKET_SIZE; i++) {
+        const float x1 = (box.min.x - packet.startX[i]) * packet.inverseDeltaX[i];
+        const float x2 = (box.max.x - packet.startX[i]) * packet.inverseDeltaX[i];
+        const float y1 = (box.min.y - packet.startY[i]) * packet.inverseDeltaY[i];
+        const float y2 = (box.max.y - packet.startY[i]) * packet.inverseDeltaY[i];
+
+        const float tMin = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), 0.0f);
+        const float tMax = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), maxFractions[i]);
+        isCrossing[i] = (tMin <= tMax) & (maxFractions[i] > 0.0f);
+    }
+
+    int laneMask = 0;
+    for (int i = 0; i < PACKET_SIZE; i++)
+        laneMask |= isCrossing[i] << i;
+    return laneMask;
+}
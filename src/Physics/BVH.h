@@ -0,0 +1,157 @@
+#ifndef BVH_H
+#define BVH_H
+
+#pragma once
+
+#include <vector>
+
+#include "AABB.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Static bounding volume hierarchy, built once from a set of boxes and
+// queried many times. Items are referred to by their index in the build set.
+///////////////////////////////////////////////////////////////////////////////
+class BVH
+{
+public:
+    void Build(const std::vector<AABB>& boxes);
+    void Clear();
+
+    inline bool IsEmpty() const { return nodes.empty(); }
+    inline const AABB& GetItemBox(int index) const { return itemBoxes[index]; }
+
+    // Call callback(index) for every item overlapping the box, stop when it returns false
+    template <typename Callback>
+    void Query(const AABB& box, Callback&& callback) const;
+
+    // Call callback(index) for every item whose box the ray start -> end crosses within maxFraction.
+    // The callback returns the new maxFraction, clipping the rest of the traversal (zero stops it).
+    template <typename Callback>
+    void RayCast(const Vec2& start, const Vec2& end, float maxFraction, Callback&& callback) const;
+
+    // Number of rays traversed together by RayCastPacket
+    static constexpr int PACKET_SIZE = 8;
+
+    // Traverse the tree once for PACKET_SIZE rays, visiting a node when any ray crosses it. Calls
+    // callback(index, laneMask) for every item box crossed, bit i of laneMask set for each ray i crossing it.
+    // The callback clips maxFractions itself, rays with a max fraction of zero or less are left out.
+    template <typename Callback>
+    void RayCastPacket(const Vec2* starts, const Vec2* ends, float* maxFractions, Callback&& callback) const;
+
+private:
+    static constexpr int MAX_LEAF_ITEMS = 4;
+    static constexpr int MAX_DEPTH = 64;
+
+    struct Node {
+        AABB box{};
+        int left = -1;      // Child nodes, -1 for leaves
+        int right = -1;
+        int start = 0;      // Range of the leaf items in "indices"
+        int count = 0;
+    };
+
+    // Rays of a packet laid out lane by lane so the slab tests run across all of them at once
+    struct RayPacket {
+        float startX[PACKET_SIZE];
+        float startY[PACKET_SIZE];
+        float inverseDeltaX[PACKET_SIZE];
+        float inverseDeltaY[PACKET_SIZE];
+    };
+
+    int BuildNode(int start, int count, int depth);
+    static RayPacket MakeRayPacket(const Vec2* starts, const Vec2* ends);
+    static int IntersectsPacket(const AABB& box, const RayPacket& packet, const float* maxFractions);
+
+    std::vector<Node> nodes;
+    std::vector<int> indices;
+    std::vector<AABB> itemBoxes;
+};
+
+template <typename Callback>
+void BVH::Query(const AABB& box, Callback&& callback) const {
+    if (nodes.empty()) return;
+
+    int stack[MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        if (!node.box.Overlaps(box)) continue;
+
+        if (node.left < 0) {
+            for (int i = node.start; i < node.start + node.count; i++) {
+                const int index = indices[i];
+                if (itemBoxes[index].Overlaps(box) && !callback(index))
+                    return;
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.left;
+        stack[stackSize++] = node.right;
+    }
+}
+
+template <typename Callback>
+void BVH::RayCast(const Vec2& start, const Vec2& end, float maxFraction, Callback&& callback) const {
+    if (nodes.empty()) return;
+
+    const Vec2 delta = end - start;
+    int stack[MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        if (!node.box.IntersectsRay(start, delta, maxFraction)) continue;
+
+        if (node.left < 0) {
+            for (int i = node.start; i < node.start + node.count; i++) {
+                const int index = indices[i];
+                if (!itemBoxes[index].IntersectsRay(start, delta, maxFraction)) continue;
+
+                maxFraction = callback(index);
+                if (maxFraction <= 0.0f) return;
+            }
+            continue;
+        }
+
+        // Nearer child goes on top, so hits found early clip the farther one
+        const bool isLeftNearer = (nodes[node.left].box.GetCenter() - nodes[node.right].box.GetCenter()).Dot(delta) < 0.0f;
+        stack[stackSize++] = isLeftNearer ? node.right : node.left;
+        stack[stackSize++] = isLeftNearer ? node.left : node.right;
+    }
+}
+
+template <typename Callback>
+void BVH::RayCastPacket(const Vec2* starts, const Vec2* ends, float* maxFractions, Callback&& callback) const {
+    if (nodes.empty()) return;
+
+    const RayPacket packet = MakeRayPacket(starts, ends);
+    int stack[MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        if (!IntersectsPacket(node.box, packet, maxFractions)) continue;
+
+        if (node.left < 0) {
+            for (int i = node.start; i < node.start + node.count; i++) {
+                const int index = indices[i];
+                const int laneMask = IntersectsPacket(itemBoxes[index], packet, maxFractions);
+                if (laneMask) callback(index, laneMask);
+            }
+            continue;
+        }
+
+        // Nearer child along the first ray goes on top, so hits found early clip the rest of the packet
+        const Vec2 direction = ends[0] - starts[0];
+        const bool isLeftNearer = (nodes[node.left].box.GetCenter() - nodes[node.right].box.GetCenter()).Dot(direction) < 0.0f;
+        stack[stackSize++] = isLeftNearer ? node.right : node.left;
+        stack[stackSize++] = isLeftNearer ? node.left : node.right;
+    }
+}
+
+#endif
@@ -32,6 +32,14 @@ bool Body::IsStatic() const
     return std::abs(inverseMass) < std::numeric_limits<float>::epsilon();
 }
 
+bool Body::ShouldCollide(const Body& other) const
+{
+    if (groupIndex != 0 && groupIndex == other.groupIndex)
+        return groupIndex > 0;
+
+    return (categoryBits & other.maskBits) != 0 && (maskBits & other.categoryBits) != 0;
+}
+
 void Body::AddForce(const Vec2& force)
 {
     netForce += force;
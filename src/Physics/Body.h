@@ -42,12 +42,30 @@ struct Body {
 	
 	// Gravity scale
 	float gravityScale = 1.0f;
+
+	// Swept against the world at the end of each step so it can't tunnel, for small fast bodies
+	bool isBullet = false;
+
+	// Sensors only report overlaps (World::GetSensorEvents), they get no contacts and don't push anything.
+	// Two sensors don't detect each other.
+	bool isSensor = false;
+
+	// Collision filtering, two bodies collide when each one's category is in the mask of the other.
+	// A shared non zero group overrides the bits: positive always collides, negative never does.
+	// Call World::Refilter after changing them on a body already in a world.
+	unsigned int categoryBits = 0x0001;
+	unsigned int maskBits = 0xFFFFFFFF;
+	int groupIndex = 0;
+
+	// Index of the body in the static or dynamic list of its world, kept up to date by the world
+	int proxyIndex = -1;
     
 public:
     Shape* shape = nullptr;
 
 public:
     bool IsStatic() const;
+    bool ShouldCollide(const Body& other) const;
 
     void AddForce(const Vec2& force);
     void AddTorque(float torque);
@@ -1,32 +1,448 @@
 #include "CollisionDetection.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
 #include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "Body.h"
 #include "Contact.h"
 
+///////////////////////////////////////////////////////////////////////////////
+// Collider dispatch matrix indexed by (ShapeType, ShapeType)
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+    constexpr int SHAPE_TYPE_COUNT = static_cast<int>(ShapeType::COUNT);
+
+    struct Collider {
+        CollisionDetection::CollisionFunction function = nullptr;
+        bool swap = false; // The function expects the bodies in the opposite order
+    };
+
+    struct ColliderTable {
+        Collider entries[SHAPE_TYPE_COUNT][SHAPE_TYPE_COUNT];
+
+        void Set(ShapeType typeA, ShapeType typeB, CollisionDetection::CollisionFunction function) {
+            const int a = static_cast<int>(typeA);
+            const int b = static_cast<int>(typeB);
+            entries[a][b] = {function, false};
+            if (a != b)
+                entries[b][a] = {function, true};
+        }
+    };
+
+    ColliderTable& GetColliderTable() {
+        static ColliderTable table = [] {
+            ColliderTable defaults{};
+
+            // Any convex pair falls back to GJK/EPA unless a dedicated collider is registered
+            for (int a = 0; a < SHAPE_TYPE_COUNT; a++)
+                for (int b = 0; b < SHAPE_TYPE_COUNT; b++)
+                    defaults.entries[a][b] = {CollisionDetection::IsCollidingConvex, false};
+
+            defaults.Set(ShapeType::CIRCLE, ShapeType::CIRCLE, CollisionDetection::IsCollidingCircleCircle);
+            defaults.Set(ShapeType::POLYGON, ShapeType::POLYGON, CollisionDetection::IsCollidingPolygonPolygon);
+            defaults.Set(ShapeType::POLYGON, ShapeType::BOX, CollisionDetection::IsCollidingPolygonPolygon);
+            defaults.Set(ShapeType::BOX, ShapeType::BOX, CollisionDetection::IsCollidingBoxBox);
+            defaults.Set(ShapeType::POLYGON, ShapeType::CIRCLE, CollisionDetection::IsCollidingPolygonCircle);
+            defaults.Set(ShapeType::BOX, ShapeType::CIRCLE, CollisionDetection::IsCollidingPolygonCircle);
+            defaults.Set(ShapeType::CAPSULE, ShapeType::CIRCLE, CollisionDetection::IsCollidingCapsuleCircle);
+            defaults.Set(ShapeType::CAPSULE, ShapeType::CAPSULE, CollisionDetection::IsCollidingCapsuleCapsule);
+            defaults.Set(ShapeType::CAPSULE, ShapeType::POLYGON, CollisionDetection::IsCollidingCapsulePolygon);
+            defaults.Set(ShapeType::CAPSULE, ShapeType::BOX, CollisionDetection::IsCollidingCapsulePolygon);
+            defaults.Set(ShapeType::CHAIN, ShapeType::CIRCLE, CollisionDetection::IsCollidingChainCircle);
+            defaults.Set(ShapeType::CHAIN, ShapeType::POLYGON, CollisionDetection::IsCollidingChainPolygon);
+            defaults.Set(ShapeType::CHAIN, ShapeType::BOX, CollisionDetection::IsCollidingChainPolygon);
+            defaults.Set(ShapeType::CHAIN, ShapeType::CAPSULE, CollisionDetection::IsCollidingChainCapsule);
+            defaults.Set(ShapeType::CHAIN, ShapeType::CHAIN, nullptr);
+            return defaults;
+        }();
+        return table;
+    }
+
+    // Narrowphase data of a body pair reused across frames
+    struct PairCache {
+        // Support search start indices of a polygon pair
+        int abSupportIndex = 0;
+        int baSupportIndex = 0;
+        int aIncidentIndex = 0;
+        int bIncidentIndex = 0;
+
+        // Last GJK simplex of the pair
+        SimplexCache simplex{};
+    };
+
+    typedef std::pair<const Body*, const Body*> BodyPair;
+
+    struct BodyPairHash {
+        std::size_t operator()(const BodyPair& pair) const {
+            const std::size_t h1 = std::hash<const Body*>()(pair.first);
+            const std::size_t h2 = std::hash<const Body*>()(pair.second);
+            return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
+        }
+    };
+
+    std::unordered_map<BodyPair, PairCache, BodyPairHash> pairCache;
+
+    // Reject the pair if the bounding circles around both body origins are apart
+    bool AreBoundingCirclesApart(const Body* a, float aRadius, const Body* b, float bRadius) {
+        const float radiusSum = aRadius + bRadius;
+        if ((b->position - a->position).MagnitudeSquared() <= radiusSum * radiusSum)
+            return false;
+
+        CollisionDetection::stats.boundingCircleRejections++;
+        return true;
+    }
+
+    // Closest point to "point" on the segment [a, b]
+    Vec2 ClosestPointOnSegment(const Vec2& point, const Vec2& a, const Vec2& b) {
+        const Vec2 ab = b - a;
+        const float lengthSquared = ab.MagnitudeSquared();
+        if (lengthSquared <= 0.0f) return a;
+        const float t = std::clamp((point - a).Dot(ab) / lengthSquared, 0.0f, 1.0f);
+        return a + ab * t;
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Closest points between the segments [p1, q1] and [p2, q2]
+    // (Ericson, Real-Time Collision Detection, 5.1.9)
+    ////////////////////////////////////////////////////////////
+    void ClosestPointsSegmentSegment(const Vec2& p1, const Vec2& q1, const Vec2& p2, const Vec2& q2, Vec2& c1, Vec2& c2) {
+        const float epsilon = 1e-8f;
+        const Vec2 d1 = q1 - p1;
+        const Vec2 d2 = q2 - p2;
+        const Vec2 r = p1 - p2;
+        const float a = d1.Dot(d1);
+        const float e = d2.Dot(d2);
+        const float f = d2.Dot(r);
+
+        float s = 0.0f;
+        float t = 0.0f;
+        if (a <= epsilon && e <= epsilon) {
+            // Both segments degenerate into points
+        } else if (a <= epsilon) {
+            t = std::clamp(f / e, 0.0f, 1.0f);
+        } else {
+            const float c = d1.Dot(r);
+            if (e <= epsilon) {
+                s = std::clamp(-c / a, 0.0f, 1.0f);
+            } else {
+                // Non parallel segments pick the closest point of the lines, parallel ones start at p1
+                const float b = d1.Dot(d2);
+                const float denom = a * e - b * b;
+                s = (denom != 0.0f) ? std::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+                t = (b * s + f) / e;
+                if (t < 0.0f) {
+                    t = 0.0f;
+                    s = std::clamp(-c / a, 0.0f, 1.0f);
+                } else if (t > 1.0f) {
+                    t = 1.0f;
+                    s = std::clamp((b - c) / a, 0.0f, 1.0f);
+                }
+            }
+        }
+        c1 = p1 + d1 * s;
+        c2 = p2 + d2 * t;
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Contact of a round core point against a one-sided chain
+    // segment. Vertex regions are owned by a single segment and
+    // flat or concave seams only produce face normals, so shapes
+    // don't snag on the internal vertices of the chain.
+    ////////////////////////////////////////////////////////////
+    bool FindRoundSegmentContact(const ChainSegment& segment, const Vec2& core, float radius, Vec2& outNormal, Vec2& outSegmentPoint, float& outSeparation) {
+        const Vec2 edge = segment.v2 - segment.v1;
+        const float faceDistance = (core - segment.v1).Dot(segment.normal);
+
+        // One-sided, ignore cores behind the segment
+        if (faceDistance < 0.0f) return false;
+
+        const float t = (core - segment.v1).Dot(edge) / edge.MagnitudeSquared();
+        if (t >= 0.0f && t <= 1.0f) {
+            outNormal = segment.normal;
+            outSegmentPoint = segment.v1 + edge * t;
+            outSeparation = faceDistance - radius;
+            return outSeparation <= 0.0f;
+        }
+
+        if (t < 0.0f) {
+            // Flat and concave seams belong to the previous face, convex ones only past its end
+            if (segment.hasPrevious && (!segment.isConvex1 || (core - segment.v1).Dot(segment.v1 - segment.v0) <= 0.0f))
+                return false;
+            outSegmentPoint = segment.v1;
+        } else {
+            // The next segment owns the v2 region
+            if (segment.hasNext) return false;
+            outSegmentPoint = segment.v2;
+        }
+
+        const Vec2 offset = core - outSegmentPoint;
+        const float distance = offset.Magnitude();
+        outSeparation = distance - radius;
+        if (outSeparation > 0.0f || distance <= 0.0f) return false;
+
+        outNormal = offset / distance;
+        return true;
+    }
+
+    // Whether the unit vector "v" lies inside the cone going from "a" to "b" (less than 180 degrees apart)
+    bool IsInsideCone(const Vec2& v, const Vec2& a, const Vec2& b) {
+        const float sign = a.Cross(b);
+        return a.Cross(v) * sign >= 0.0f && v.Cross(b) * sign >= 0.0f && v.Dot(a + b) > 0.0f;
+    }
+
+    // Fixed-size version of PolygonShape::ClipSegmentToLine, the line is given by its outward normal and a point
+    int ClipSegmentToPlane(const Vec2 (&contactsIn)[2], Vec2 (&contactsOut)[2], const Vec2& normal, const Vec2& point) {
+        int numOut = 0;
+
+        // Calculate the distance of end points to the line
+        const float dist0 = (contactsIn[0] - point).Dot(normal);
+        const float dist1 = (contactsIn[1] - point).Dot(normal);
+
+        // If the points are behind the plane
+        if (dist0 <= 0)
+            contactsOut[numOut++] = contactsIn[0];
+        if (dist1 <= 0)
+            contactsOut[numOut++] = contactsIn[1];
+
+        // If the points are on different sides of the plane, add the intersection
+        if (dist0 * dist1 < 0) {
+            const float t = dist0 / (dist0 - dist1);
+            contactsOut[numOut++] = contactsIn[0] + (contactsIn[1] - contactsIn[0]) * t;
+        }
+        return numOut;
+    }
+
+    ////////////////////////////////////////////////////////////
+    // SAT of a polygon against a one-sided chain segment. Only
+    // polygon faces whose normal fits the cone allowed by the
+    // ghost vertices can become the reference face, otherwise
+    // the segment normal is used.
+    ////////////////////////////////////////////////////////////
+    void CollideSegmentPolygon(const ChainSegment& segment, Body* chain, Body* polygon, std::vector<Contact>& contacts) {
+        const PolygonShape* polygonShape = static_cast<PolygonShape*>(polygon->shape);
+        const std::vector<Vec2>& vertices = polygonShape->worldVertices;
+        const int count = static_cast<int>(vertices.size());
+        const Vec2& v1 = segment.v1;
+        const Vec2& v2 = segment.v2;
+        const Vec2& normal = segment.normal;
+
+        // One-sided, ignore polygons centered behind the segment
+        if ((polygon->position - v1).Dot(normal) < 0.0f) return;
+
+        // Segment face axis
+        float edgeSeparation = std::numeric_limits<float>::max();
+        for (const Vec2& vertex: vertices)
+            edgeSeparation = std::min(edgeSeparation, (vertex - v1).Dot(normal));
+        if (edgeSeparation > 0.0f) return;
+
+        // Normals allowed at the segment ends, open ends behave like convex corners
+        const Vec2 tangent = (v2 - v1).UnitVector();
+        const Vec2 normal0 = segment.hasPrevious ? (v1 - segment.v0).Normal() : tangent * -1.0f;
+        const Vec2 normal3 = segment.hasNext ? (segment.v3 - v2).Normal() : tangent;
+        const bool isOpen1 = !segment.hasPrevious || segment.isConvex1;
+        const bool isOpen2 = !segment.hasNext || segment.isConvex2;
+
+        // Polygon face axes
+        float polygonSeparation = std::numeric_limits<float>::lowest();
+        int polygonEdge = -1;
+        for (int i = 0; i < count; i++) {
+            const Vec2 faceNormal = polygonShape->GetNormal(i);
+            const float separation = std::min((v1 - vertices[i]).Dot(faceNormal), (v2 - vertices[i]).Dot(faceNormal));
+            if (separation > 0.0f) return;
+
+            const Vec2 contactNormal = faceNormal * -1.0f;
+            const bool isAllowed = contactNormal.Dot(normal) > 0.999f ||
+                (isOpen1 && IsInsideCone(contactNormal, normal0, normal)) ||
+                (isOpen2 && IsInsideCone(contactNormal, normal, normal3));
+            if (isAllowed && separation > polygonSeparation) {
+                polygonSeparation = separation;
+                polygonEdge = i;
+            }
+        }
+
+        Vec2 clipped[2], points[2];
+        if (polygonEdge >= 0 && polygonSeparation > 0.98f * edgeSeparation + 0.05f) {
+            // Polygon face is the reference, clip the segment to it
+            const Vec2& w1 = vertices[polygonEdge];
+            const Vec2& w2 = vertices[(polygonEdge + 1) % count];
+            const Vec2 faceNormal = polygonShape->GetNormal(polygonEdge);
+            const Vec2 faceTangent = (w2 - w1).UnitVector();
+            const Vec2 segmentPoints[2] = {v1, v2};
+            if (ClipSegmentToPlane(segmentPoints, clipped, faceTangent * -1.0f, w1) < 2) return;
+            if (ClipSegmentToPlane(clipped, points, faceTangent, w2) < 2) return;
+
+            for (const Vec2& point: points) {
+                const float separation = (point - w1).Dot(faceNormal);
+                if (separation > 0.0f) continue;
+
+                Contact contact{};
+                contact.a = chain;
+                contact.b = polygon;
+                contact.normal = faceNormal * -1.0f;
+                contact.start = point - faceNormal * separation;
+                contact.end = point;
+                contact.depth = -separation;
+                contacts.push_back(contact);
+            }
+            return;
+        }
+
+        // Segment is the reference, clip the incident polygon edge to the segment extent
+        const int incidentIndex = polygonShape->FindIncidentEdge(normal);
+        const Vec2 incidentPoints[2] = {vertices[incidentIndex], vertices[(incidentIndex + 1) % count]};
+        if (ClipSegmentToPlane(incidentPoints, clipped, tangent * -1.0f, v1) < 2) return;
+        if (ClipSegmentToPlane(clipped, points, tangent, v2) < 2) return;
+
+        for (const Vec2& point: points) {
+            const float separation = (point - v1).Dot(normal);
+            if (separation > 0.0f) continue;
+
+            Contact contact{};
+            contact.a = chain;
+            contact.b = polygon;
+            contact.normal = normal;
+            contact.start = point;
+            contact.end = point - normal * separation;
+            contact.depth = -separation;
+            contacts.push_back(contact);
+        }
+    }
+}
+
+CollisionStats CollisionDetection::stats{};
+
+void CollisionDetection::ResetStats() {
+    stats = CollisionStats{};
+}
+
+void CollisionDetection::ClearCache(const Body* body) {
+    for (auto it = pairCache.begin(); it != pairCache.end();) {
+        if (it->first.first == body || it->first.second == body)
+            it = pairCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void CollisionDetection::ClearCache(const Body* a, const Body* b) {
+    pairCache.erase(BodyPair(a, b));
+    pairCache.erase(BodyPair(b, a));
+}
+
+void CollisionDetection::ClearCache(const std::vector<Body*>& bodies) {
+    const std::unordered_set<const Body*> removed(bodies.begin(), bodies.end());
+    for (auto it = pairCache.begin(); it != pairCache.end();) {
+        if (removed.count(it->first.first) || removed.count(it->first.second))
+            it = pairCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void CollisionDetection::RegisterCollider(ShapeType typeA, ShapeType typeB, CollisionFunction function) {
+    GetColliderTable().Set(typeA, typeB, function);
+}
+
 bool CollisionDetection::IsColliding(Body* a, Body* b, std::vector<Contact>& contacts) {
-    ShapeType typeA = a->shape->GetType();
-    ShapeType typeB = b->shape->GetType();
+    const int typeA = static_cast<int>(a->shape->GetType());
+    const int typeB = static_cast<int>(b->shape->GetType());
 
-    if (typeA == ShapeType::CIRCLE && typeB == ShapeType::CIRCLE)
-        return IsCollidingCircleCircle(a, b, contacts);
+    const Collider& collider = GetColliderTable().entries[typeA][typeB];
+    if (!collider.function) return false;
 
-    if ((typeA == ShapeType::POLYGON || typeA == ShapeType::BOX) &&
-        (typeB == ShapeType::POLYGON || typeB == ShapeType::BOX))
-        return IsCollidingPolygonPolygon(a, b, contacts);
+    if (!collider.swap)
+        return collider.function(a, b, contacts);
 
-    if ((typeA == ShapeType::POLYGON || typeA == ShapeType::BOX) &&
-        typeB == ShapeType::CIRCLE)
-        return IsCollidingPolygonCircle(a, b, contacts);
+    // Run the collider with the bodies swapped, then flip the new contacts back so they go from "a" to "b"
+    const std::size_t first = contacts.size();
+    if (!collider.function(b, a, contacts)) return false;
 
-    if ((typeB == ShapeType::POLYGON || typeB == ShapeType::BOX) &&
-        typeA == ShapeType::CIRCLE)
-        return IsCollidingPolygonCircle(b, a, contacts);
+    for (std::size_t i = first; i < contacts.size(); i++) {
+        Contact& contact = contacts[i];
+        std::swap(contact.a, contact.b);
+        std::swap(contact.start, contact.end);
+        contact.normal *= -1.0f;
+    }
+    return true;
+}
 
-    return false;
+///////////////////////////////////////////////////////////////////////////////
+// Speculative contacts
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+    // Contact between the closest points of two separated shapes, "pointA" on "a" and "pointB" on "b"
+    Contact MakeSpeculativeContact(Body *a, Body *b, const Vec2 &pointA, const Vec2 &pointB, float distance) {
+        Contact contact{};
+        contact.a = a;
+        contact.b = b;
+        contact.normal = (pointB - pointA) / distance;
+        contact.start = pointB;
+        contact.end = pointA;
+        contact.depth = -distance;
+        return contact;
+    }
 }
 
+bool CollisionDetection::IsCollidingSpeculative(Body *a, Body *b, float margin, std::vector<Contact> &contacts) {
+    const std::size_t first = contacts.size();
+    const bool isColliding = IsColliding(a, b, contacts);
+    if (margin <= 0.0f) return isColliding;
+
+    const bool isChainA = a->shape->GetType() == ShapeType::CHAIN;
+    const bool isChainB = b->shape->GetType() == ShapeType::CHAIN;
+    if (isChainA && isChainB) return isColliding;
+
+    // Cheap rejection on the bounds grown by the margin
+    const Vec2 grow(margin, margin);
+    const AABB boxA = a->shape->GetAABB();
+    if (!AABB(boxA.min - grow, boxA.max + grow).Overlaps(b->shape->GetAABB())) return isColliding;
+
+    // Convex pairs get a single contact between their closest points
+    if (!isChainA && !isChainB) {
+        if (isColliding) return true;
+
+        DistanceOutput output;
+        GetDistance(a, b, output);
+        if (output.distance <= 0.0f || output.distance > margin) return false;
+
+        contacts.push_back(MakeSpeculativeContact(a, b, output.pointA, output.pointB, output.distance));
+        return true;
+    }
+
+    // Chains get one for every nearby segment from its front side, other segments may be touching already
+    Body *chain = isChainA ? a : b;
+    Body *other = isChainA ? b : a;
+    const ChainShape *chainShape = static_cast<ChainShape *>(chain->shape);
+    const AABB otherBox = other->shape->GetAABB();
+
+    chainShape->tree.Query(AABB(otherBox.min - grow, otherBox.max + grow), [&](int index) {
+        const ChainSegment segment = chainShape->GetSegment(index);
+        if ((other->position - segment.v1).Dot(segment.normal) < 0.0f) return true;
+
+        DistanceOutput output;
+        GJK::Distance(chainShape->GetSegmentShape(index), *other->shape, output);
+        if (output.distance <= 0.0f || output.distance > margin) return true;
+
+        // Like the ghost vertices of the chain colliders, flat and concave seams belong to the neighbour face
+        const float t = (output.pointA - segment.v1).Dot(segment.v2 - segment.v1) / (segment.v2 - segment.v1).MagnitudeSquared();
+        if ((t <= 0.0f && segment.hasPrevious && !segment.isConvex1) || (t >= 1.0f && segment.hasNext && !segment.isConvex2))
+            return true;
+
+        if (isChainA)
+            contacts.push_back(MakeSpeculativeContact(chain, other, output.pointA, output.pointB, output.distance));
+        else
+            contacts.push_back(MakeSpeculativeContact(other, chain, output.pointB, output.pointA, output.distance));
+        return true;
+    });
+
+    return contacts.size() > first;
+}
 
 bool CollisionDetection::IsCollidingCircleCircle(Body *a, Body *b, std::vector<Contact> &contacts) {
     // Get the circle shapes
@@ -65,15 +481,25 @@ bool CollisionDetection::IsCollidingPolygonPolygon(Body *a, Body *b, std::vector
     PolygonShape *aPolygonShape = dynamic_cast<PolygonShape *>(a->shape);
     PolygonShape *bPolygonShape = dynamic_cast<PolygonShape *>(b->shape);
 
+    if (AreBoundingCirclesApart(a, aPolygonShape->boundingRadius, b, bPolygonShape->boundingRadius)) return false;
+
+    PairCache& cache = pairCache[BodyPair(a, b)];
+
     int aIndexReferenceEdge;
     Vec2 aSupportPoint;
-    float abSeparation = aPolygonShape->FindMinSeparation(*bPolygonShape, aIndexReferenceEdge, aSupportPoint);
-    if (abSeparation >= 0) return false;
+    float abSeparation = aPolygonShape->FindMinSeparation(*bPolygonShape, aIndexReferenceEdge, aSupportPoint, cache.abSupportIndex);
+    if (abSeparation >= 0) {
+        stats.separatingAxisRejections++;
+        return false;
+    }
 
     int bIndexReferenceEdge;
     Vec2 bSupportPoint;
-    float baSeparation = bPolygonShape->FindMinSeparation(*aPolygonShape, bIndexReferenceEdge, bSupportPoint);
-    if (baSeparation >= 0) return false;
+    float baSeparation = bPolygonShape->FindMinSeparation(*aPolygonShape, bIndexReferenceEdge, bSupportPoint, cache.baSupportIndex);
+    if (baSeparation >= 0) {
+        stats.separatingAxisRejections++;
+        return false;
+    }
 
     // Set the reference and incident polygon
     PolygonShape* referenceShape, *incidentShape;
@@ -94,7 +520,9 @@ bool CollisionDetection::IsCollidingPolygonPolygon(Body *a, Body *b, std::vector
     ///////////////////////////////////// 
     // Clipping 
     /////////////////////////////////////
-    int incidentIndex = incidentShape->FindIncidentEdge(referenceEdge.Normal());
+    int& incidentStartIndex = (incidentShape == aPolygonShape) ? cache.aIncidentIndex : cache.bIncidentIndex;
+    int incidentIndex = incidentShape->FindIncidentEdge(referenceEdge.Normal(), incidentStartIndex);
+    incidentStartIndex = incidentIndex;
     int incidentNextIndex = (incidentIndex + 1) % incidentShape->worldVertices.size();
     Vec2 v0 = incidentShape->worldVertices[incidentIndex];
     Vec2 v1 = incidentShape->worldVertices[incidentNextIndex];
@@ -137,11 +565,92 @@ bool CollisionDetection::IsCollidingPolygonPolygon(Body *a, Body *b, std::vector
     return true;
 }
 
+bool CollisionDetection::IsCollidingBoxBox(Body *a, Body *b, std::vector<Contact> &contacts) {
+    const BoxShape *aBoxShape = static_cast<BoxShape *>(a->shape);
+    const BoxShape *bBoxShape = static_cast<BoxShape *>(b->shape);
+
+    if (AreBoundingCirclesApart(a, aBoxShape->boundingRadius, b, bBoxShape->boundingRadius)) return false;
+
+    // SAT on the 4 face axes using half extents
+    int aIndexReferenceEdge;
+    const float abSeparation = aBoxShape->FindMinSeparation(*bBoxShape, aIndexReferenceEdge);
+    if (abSeparation >= 0) {
+        stats.separatingAxisRejections++;
+        return false;
+    }
+
+    int bIndexReferenceEdge;
+    const float baSeparation = bBoxShape->FindMinSeparation(*aBoxShape, bIndexReferenceEdge);
+    if (baSeparation >= 0) {
+        stats.separatingAxisRejections++;
+        return false;
+    }
+
+    // Set the reference and incident box
+    const BoxShape *referenceShape, *incidentShape;
+    int indexReferenceEdge;
+    if (abSeparation > baSeparation) {
+        referenceShape = aBoxShape;
+        incidentShape = bBoxShape;
+        indexReferenceEdge = aIndexReferenceEdge;
+    } else {
+        referenceShape = bBoxShape;
+        incidentShape = aBoxShape;
+        indexReferenceEdge = bIndexReferenceEdge;
+    }
+    const Vec2 referenceNormal = referenceShape->GetFaceNormal(indexReferenceEdge);
+
+    ///////////////////////////////////// 
+    // Clipping (same edge order as the polygon path, without allocations)
+    /////////////////////////////////////
+    const int incidentIndex = incidentShape->FindIncidentEdge(referenceNormal);
+    Vec2 contactPoints[2] = {
+        incidentShape->worldVertices[incidentIndex],
+        incidentShape->worldVertices[(incidentIndex + 1) % 4]
+    };
+    Vec2 clippedPoints[2] = {contactPoints[0], contactPoints[1]};
+    for (int i = 0; i < 4; i++) {
+        if (i == indexReferenceEdge)
+            continue;
+        const int numClipped = ClipSegmentToPlane(contactPoints, clippedPoints, referenceShape->GetFaceNormal(i), referenceShape->worldVertices[i]);
+        if (numClipped < 2) {
+            break;
+        }
+
+        contactPoints[0] = clippedPoints[0];
+        contactPoints[1] = clippedPoints[1];
+    }
+
+    const Vec2 &vref = referenceShape->worldVertices[indexReferenceEdge];
+
+    // Only consider clipped points where separation is negative (objects are penetrating each other)
+    for (const Vec2 &vclip: clippedPoints) {
+        const float separation = (vclip - vref).Dot(referenceNormal);
+        if (separation <= 0) {
+            Contact contact;
+            contact.a = a;
+            contact.b = b;
+            contact.normal = referenceNormal;
+            contact.start = vclip;
+            contact.end = vclip + contact.normal * -separation;
+            if (baSeparation >= abSeparation) {
+                std::swap(contact.start, contact.end); // the start-end points are always from "a" to "b"
+                contact.normal *= -1.0;                // the collision normal is always from "a" to "b"
+            }
+
+            contacts.push_back(contact);
+        }
+    }
+    return true;
+}
+
 bool CollisionDetection::IsCollidingPolygonCircle(Body *polygon, Body *circle, std::vector<Contact> &contacts) {
     const PolygonShape *polygonShape = dynamic_cast<PolygonShape *>(polygon->shape);
     const CircleShape *circleShape = dynamic_cast<CircleShape *>(circle->shape);
     const std::vector<Vec2> &polygonVertices = polygonShape->worldVertices;
 
+    if (AreBoundingCirclesApart(polygon, polygonShape->boundingRadius, circle, circleShape->radius)) return false;
+
     bool isOutside = false;
     Vec2 minCurrVertex;
     Vec2 minNextVertex;
@@ -187,6 +696,7 @@ bool CollisionDetection::IsCollidingPolygonCircle(Body *polygon, Body *circle, s
         contact.start = circle->position - (contact.normal * circleShape->radius);
         contact.end = contact.start + (contact.normal * contact.depth);
 
+        contacts.push_back(contact);
         return true;
     }
 
@@ -236,3 +746,368 @@ bool CollisionDetection::IsCollidingPolygonCircle(Body *polygon, Body *circle, s
     contacts.push_back(contact);
     return true;
 }
+
+bool CollisionDetection::IsCollidingCapsuleCircle(Body *capsule, Body *circle, std::vector<Contact> &contacts) {
+    const CapsuleShape *capsuleShape = static_cast<CapsuleShape *>(capsule->shape);
+    const CircleShape *circleShape = static_cast<CircleShape *>(circle->shape);
+
+    // Closest point of the capsule segment to the circle center
+    const Vec2 closest = ClosestPointOnSegment(circle->position, capsuleShape->worldPoint1, capsuleShape->worldPoint2);
+    const Vec2 distance = circle->position - closest;
+    const float radiusSum = capsuleShape->radius + circleShape->radius;
+    if (distance.MagnitudeSquared() > radiusSum * radiusSum) return false;
+
+    // Circle center on the segment, push it out sideways
+    Vec2 normal;
+    if (distance.MagnitudeSquared() > 0.0f)
+        normal = distance.UnitVector();
+    else
+        normal = (capsuleShape->worldPoint2 - capsuleShape->worldPoint1).Normal();
+
+    Contact contact{};
+    contact.a = capsule;
+    contact.b = circle;
+    contact.normal = normal;
+    contact.start = circle->position - contact.normal * circleShape->radius;
+    contact.end = closest + contact.normal * capsuleShape->radius;
+    contact.depth = (contact.end - contact.start).Magnitude();
+
+    contacts.push_back(contact);
+    return true;
+}
+
+bool CollisionDetection::IsCollidingCapsuleCapsule(Body *a, Body *b, std::vector<Contact> &contacts) {
+    const CapsuleShape *aCapsule = static_cast<CapsuleShape *>(a->shape);
+    const CapsuleShape *bCapsule = static_cast<CapsuleShape *>(b->shape);
+
+    if (AreBoundingCirclesApart(a, aCapsule->GetBoundingRadius(), b, bCapsule->GetBoundingRadius())) return false;
+
+    // Distance between the two segments
+    Vec2 aClosest, bClosest;
+    ClosestPointsSegmentSegment(aCapsule->worldPoint1, aCapsule->worldPoint2, bCapsule->worldPoint1, bCapsule->worldPoint2, aClosest, bClosest);
+    const float radiusSum = aCapsule->radius + bCapsule->radius;
+    const float distance = (bClosest - aClosest).Magnitude();
+    if (distance > radiusSum) return false;
+
+    // Crossing segments have no closest point direction, find the penetration with EPA
+    if (distance < 1e-4f)
+        return IsCollidingConvex(a, b, contacts);
+
+    const Vec2 normal = (bClosest - aClosest) / distance;
+    const Vec2 aAxis = (aCapsule->worldPoint2 - aCapsule->worldPoint1).UnitVector();
+    const Vec2 bAxis = (bCapsule->worldPoint2 - bCapsule->worldPoint1).UnitVector();
+
+    // Nearly parallel capsules lying side by side get one contact at each end of the overlap
+    Vec2 bPoints[2] = {bClosest, bClosest};
+    int numPoints = 1;
+    if (std::abs(aAxis.Cross(bAxis)) < 0.02f) {
+        const Vec2 segment[2] = {bCapsule->worldPoint1, bCapsule->worldPoint2};
+        Vec2 clipped[2];
+        if (ClipSegmentToPlane(segment, clipped, aAxis * -1.0f, aCapsule->worldPoint1) == 2 &&
+            ClipSegmentToPlane(clipped, bPoints, aAxis, aCapsule->worldPoint2) == 2)
+            numPoints = 2;
+        else
+            bPoints[0] = bClosest;
+    }
+
+    for (int i = 0; i < numPoints; i++) {
+        const Vec2 aPoint = ClosestPointOnSegment(bPoints[i], aCapsule->worldPoint1, aCapsule->worldPoint2);
+        const float separation = (bPoints[i] - aPoint).Dot(normal);
+        if (separation > radiusSum) continue;
+
+        Contact contact{};
+        contact.a = a;
+        contact.b = b;
+        contact.normal = normal;
+        contact.start = bPoints[i] - normal * bCapsule->radius;
+        contact.end = aPoint + normal * aCapsule->radius;
+        contact.depth = radiusSum - separation;
+        contacts.push_back(contact);
+    }
+    return true;
+}
+
+bool CollisionDetection::IsCollidingCapsulePolygon(Body *capsule, Body *polygon, std::vector<Contact> &contacts) {
+    const CapsuleShape *capsuleShape = static_cast<CapsuleShape *>(capsule->shape);
+    const PolygonShape *polygonShape = static_cast<PolygonShape *>(polygon->shape);
+    const std::vector<Vec2> &vertices = polygonShape->worldVertices;
+    const Vec2 &p1 = capsuleShape->worldPoint1;
+    const Vec2 &p2 = capsuleShape->worldPoint2;
+
+    if (AreBoundingCirclesApart(capsule, capsuleShape->GetBoundingRadius(), polygon, polygonShape->boundingRadius)) return false;
+
+    // Distance from the capsule segment to the polygon boundary, finding the closest edge
+    float minDistanceSquared = std::numeric_limits<float>::max();
+    Vec2 capsuleClosest, polygonClosest;
+    int closestEdge = 0;
+    bool isInside = true;
+    for (int i = 0; i < vertices.size(); i++) {
+        const Vec2 &v0 = vertices[i];
+        const Vec2 &v1 = vertices[(i + 1) % vertices.size()];
+        if ((p1 - v0).Dot(polygonShape->GetNormal(i)) > 0)
+            isInside = false;
+
+        Vec2 segmentPoint, edgePoint;
+        ClosestPointsSegmentSegment(p1, p2, v0, v1, segmentPoint, edgePoint);
+        const float distanceSquared = (edgePoint - segmentPoint).MagnitudeSquared();
+        if (distanceSquared < minDistanceSquared) {
+            minDistanceSquared = distanceSquared;
+            capsuleClosest = segmentPoint;
+            polygonClosest = edgePoint;
+            closestEdge = i;
+        }
+    }
+
+    const float distance = std::sqrt(minDistanceSquared);
+    if (!isInside && distance > capsuleShape->radius) return false;
+
+    // The segment crosses or lies inside the polygon, find the penetration with EPA
+    if (isInside || distance < 1e-4f)
+        return IsCollidingConvex(capsule, polygon, contacts);
+
+    // Normal from the capsule to the polygon
+    const Vec2 normal = (polygonClosest - capsuleClosest) / distance;
+    const Vec2 edgeNormal = polygonShape->GetNormal(closestEdge);
+    const Vec2 axis = (p2 - p1).UnitVector();
+
+    // A capsule resting flat on an edge gets the segment clipped to the edge, otherwise one contact
+    Vec2 capsulePoints[2] = {capsuleClosest, capsuleClosest};
+    int numPoints = 1;
+    if (normal.Dot(edgeNormal) < -0.999f && std::abs(axis.Dot(edgeNormal)) < 0.02f) {
+        const Vec2 &v0 = vertices[closestEdge];
+        const Vec2 &v1 = vertices[(closestEdge + 1) % vertices.size()];
+        const Vec2 tangent = (v1 - v0).UnitVector();
+        const Vec2 segment[2] = {p1, p2};
+        Vec2 clipped[2];
+        if (ClipSegmentToPlane(segment, clipped, tangent * -1.0f, v0) == 2 &&
+            ClipSegmentToPlane(clipped, capsulePoints, tangent, v1) == 2)
+            numPoints = 2;
+        else
+            capsulePoints[0] = capsuleClosest;
+    }
+
+    for (int i = 0; i < numPoints; i++) {
+        // Clipped points are projected onto the polygon edge
+        Vec2 polygonPoint = polygonClosest;
+        if (numPoints == 2)
+            polygonPoint = capsulePoints[i] - edgeNormal * (capsulePoints[i] - vertices[closestEdge]).Dot(edgeNormal);
+
+        const float separation = (polygonPoint - capsulePoints[i]).Dot(normal);
+        if (separation > capsuleShape->radius) continue;
+
+        Contact contact{};
+        contact.a = capsule;
+        contact.b = polygon;
+        contact.normal = normal;
+        contact.start = polygonPoint;
+        contact.end = capsulePoints[i] + normal * capsuleShape->radius;
+        contact.depth = capsuleShape->radius - separation;
+        contacts.push_back(contact);
+    }
+    return true;
+}
+
+bool CollisionDetection::IsCollidingChainCircle(Body *chain, Body *circle, std::vector<Contact> &contacts) {
+    const ChainShape *chainShape = static_cast<ChainShape *>(chain->shape);
+    const CircleShape *circleShape = static_cast<CircleShape *>(circle->shape);
+    const std::size_t first = contacts.size();
+
+    // Only the segments near the circle are tested
+    chainShape->tree.Query(circleShape->GetAABB(), [&](int index) {
+        const ChainSegment segment = chainShape->GetSegment(index);
+        Vec2 normal, segmentPoint;
+        float separation;
+        if (!FindRoundSegmentContact(segment, circle->position, circleShape->radius, normal, segmentPoint, separation))
+            return true;
+
+        Contact contact{};
+        contact.a = chain;
+        contact.b = circle;
+        contact.normal = normal;
+        contact.start = circle->position - normal * circleShape->radius;
+        contact.end = segmentPoint;
+        contact.depth = -separation;
+        contacts.push_back(contact);
+        return true;
+    });
+
+    return contacts.size() > first;
+}
+
+bool CollisionDetection::IsCollidingChainPolygon(Body *chain, Body *polygon, std::vector<Contact> &contacts) {
+    const ChainShape *chainShape = static_cast<ChainShape *>(chain->shape);
+    const std::size_t first = contacts.size();
+
+    chainShape->tree.Query(polygon->shape->GetAABB(), [&](int index) {
+        CollideSegmentPolygon(chainShape->GetSegment(index), chain, polygon, contacts);
+        return true;
+    });
+
+    return contacts.size() > first;
+}
+
+bool CollisionDetection::IsCollidingChainCapsule(Body *chain, Body *capsule, std::vector<Contact> &contacts) {
+    const ChainShape *chainShape = static_cast<ChainShape *>(chain->shape);
+    const CapsuleShape *capsuleShape = static_cast<CapsuleShape *>(capsule->shape);
+    const Vec2 &p1 = capsuleShape->worldPoint1;
+    const Vec2 &p2 = capsuleShape->worldPoint2;
+    const Vec2 axis = (p2 - p1).UnitVector();
+    const std::size_t first = contacts.size();
+
+    chainShape->tree.Query(capsuleShape->GetAABB(), [&](int index) {
+        const ChainSegment segment = chainShape->GetSegment(index);
+
+        Vec2 segmentPoint, capsulePoint;
+        ClosestPointsSegmentSegment(segment.v1, segment.v2, p1, p2, segmentPoint, capsulePoint);
+
+        // A capsule lying along the segment is clipped to the segment extent for two contacts
+        Vec2 cores[2] = {capsulePoint, capsulePoint};
+        int numCores = 1;
+        if (std::abs(axis.Dot(segment.normal)) < 0.02f) {
+            const Vec2 tangent = (segment.v2 - segment.v1).UnitVector();
+            const Vec2 capsulePoints[2] = {p1, p2};
+            Vec2 clipped[2];
+            if (ClipSegmentToPlane(capsulePoints, clipped, tangent * -1.0f, segment.v1) == 2 &&
+                ClipSegmentToPlane(clipped, cores, tangent, segment.v2) == 2)
+                numCores = 2;
+            else
+                cores[0] = capsulePoint;
+        }
+
+        for (int i = 0; i < numCores; i++) {
+            Vec2 normal;
+            float separation;
+            if (!FindRoundSegmentContact(segment, cores[i], capsuleShape->radius, normal, segmentPoint, separation))
+                continue;
+
+            Contact contact{};
+            contact.a = chain;
+            contact.b = capsule;
+            contact.normal = normal;
+            contact.start = cores[i] - normal * capsuleShape->radius;
+            contact.end = segmentPoint;
+            contact.depth = -separation;
+            contacts.push_back(contact);
+        }
+        return true;
+    });
+
+    return contacts.size() > first;
+}
+
+bool CollisionDetection::IsCollidingConvex(Body *a, Body *b, std::vector<Contact> &contacts) {
+    PenetrationOutput penetration;
+    if (!GJK::Penetration(*a->shape, *b->shape, penetration, &pairCache[BodyPair(a, b)].simplex))
+        return false;
+
+    Contact contact{};
+    contact.a = a;
+    contact.b = b;
+    contact.normal = penetration.normal;
+    contact.start = penetration.pointB;
+    contact.end = penetration.pointA;
+    contact.depth = penetration.depth;
+
+    contacts.push_back(contact);
+    return true;
+}
+
+void CollisionDetection::GetDistance(Body *a, Body *b, DistanceOutput &output) {
+    GJK::Distance(*a->shape, *b->shape, output, &pairCache[BodyPair(a, b)].simplex);
+}
+
+bool CollisionDetection::IsOverlapping(Body *a, Body *b) {
+    const AABB bBox = b->shape->GetAABB();
+    if (!a->shape->GetAABB().Overlaps(bBox)) return false;
+
+    if (a->shape->GetType() != ShapeType::CHAIN && b->shape->GetType() != ShapeType::CHAIN) {
+        DistanceOutput output;
+        GetDistance(a, b, output);
+        return output.distance <= 0.0f;
+    }
+
+    // A chain overlaps through any of its segments, from either side
+    if (b->shape->GetType() == ShapeType::CHAIN) std::swap(a, b);
+    const ChainShape *chain = static_cast<const ChainShape *>(a->shape);
+    bool isOverlapping = false;
+    chain->tree.Query(b->shape->GetAABB(), [&](int index) {
+        DistanceOutput output;
+        GJK::Distance(chain->GetSegmentShape(index), *b->shape, output);
+        isOverlapping = output.distance <= 0.0f;
+        return !isOverlapping;
+    });
+    return isOverlapping;
+}
+
+bool CollisionDetection::GetDeepestProbeContact(Body *body, Body *probe, const Vec2 &center, float radius, std::vector<Contact> &contacts, Contact &outContact) {
+    static_cast<CircleShape*>(probe->shape)->radius = radius;
+    probe->position = center;
+    probe->shape->UpdateVertices(0.0f, probe->position);
+
+    contacts.clear();
+    if (!IsColliding(body, probe, contacts) || contacts.empty()) return false;
+
+    const Contact* deepest = &contacts[0];
+    for (const Contact& contact: contacts) {
+        if (contact.depth > deepest->depth) deepest = &contact;
+    }
+    if (deepest->depth <= 0.0f) return false;
+
+    outContact = *deepest;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Time of impact
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+    // The advancement stops short of contact so the shapes never end a step overlapped
+    constexpr float TOI_TARGET_SEPARATION = 0.5f;
+    constexpr float TOI_TOLERANCE = 0.25f;
+    constexpr int TOI_MAX_ITERATIONS = 20;
+}
+
+bool CollisionDetection::TimeOfImpact(Shape &shape, const Vec2 &position, float angle, const Vec2 &translation, float rotation, const Shape &target, float &outFraction, DistanceOutput &outDistance) {
+    // Farthest point of the shape from its center bounds the motion due to rotation
+    const AABB box = shape.GetAABB();
+    const Vec2 extent(std::max(std::abs(box.min.x - position.x), std::abs(box.max.x - position.x)),
+                      std::max(std::abs(box.min.y - position.y), std::abs(box.max.y - position.y)));
+    const float maxMotion = translation.Magnitude() + std::abs(rotation) * extent.Magnitude();
+    if (maxMotion <= 0.0f) return false;
+
+    // Overlapping shapes are left to the discrete contacts
+    GJK::Distance(shape, target, outDistance);
+    if (outDistance.distance <= 0.0f) return false;
+
+    // Already within the target, only a hit when the motion closes the gap (not when sliding along or leaving)
+    if (outDistance.distance < TOI_TARGET_SEPARATION + TOI_TOLERANCE) {
+        const Vec2 normal = (outDistance.pointA - outDistance.pointB) / outDistance.distance;
+        const Vec2 arm = outDistance.pointA - position;
+        const Vec2 motion = translation + Vec2(-arm.y, arm.x) * rotation;
+        outFraction = 0.0f;
+        return motion.Dot(normal) < -TOI_TOLERANCE;
+    }
+
+    bool isHit = false;
+    float fraction = 0.0f;
+    for (int i = 0; !isHit; i++) {
+        // Running out of iterations while still closing in counts as a hit, to stay on the safe side
+        isHit = outDistance.distance < TOI_TARGET_SEPARATION + TOI_TOLERANCE || i == TOI_MAX_ITERATIONS;
+        if (isHit) break;
+
+        // No point of the shape moves farther than maxMotion over the whole motion
+        fraction += (outDistance.distance - TOI_TARGET_SEPARATION) / maxMotion;
+        if (fraction >= 1.0f) break;
+
+        shape.UpdateVertices(angle + rotation * fraction, position + translation * fraction);
+        GJK::Distance(shape, target, outDistance);
+    }
+
+    shape.UpdateVertices(angle, position);
+    outFraction = fraction;
+    return isHit;
+}
+
+bool CollisionDetection::TimeOfImpact(Body *body, const Vec2 &translation, float rotation, const Shape &target, float &outFraction, DistanceOutput &outDistance) {
+    return TimeOfImpact(*body->shape, body->position, body->rotation, translation, rotation, target, outFraction, outDistance);
+}
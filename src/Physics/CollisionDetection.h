@@ -3,17 +3,76 @@
 
 #include <vector>
 
+#include "GJK.h"
+#include "Shape.h"
+
 // Forward declaration
 struct Contact;
 struct Body;
 struct PolygonShape;
 
+// Number of pairs rejected by each early out test, reset on every collision pass
+struct CollisionStats
+{
+    int boundingCircleRejections = 0;
+    int separatingAxisRejections = 0;
+};
+
 struct CollisionDetection
 {
+    static CollisionStats stats;
+    static void ResetStats();
+
+    // Drop the per pair data cached between frames for a body that left the world
+    static void ClearCache(const Body* body);
+
+    // Drop the data of a pair that stopped being tested, in either order
+    static void ClearCache(const Body* a, const Body* b);
+
+    // Drop the data of every pair with one of the bodies, in a single pass (a world going away)
+    static void ClearCache(const std::vector<Body*>& bodies);
+
+    // Narrowphase routine for a (typeA, typeB) pair, contacts are generated from "a" to "b"
+    typedef bool (*CollisionFunction)(Body* a, Body* b, std::vector<Contact> &contacts);
+
+    // Register a collider for a shape type pair, the mirrored pair is handled by swapping the bodies
+    static void RegisterCollider(ShapeType typeA, ShapeType typeB, CollisionFunction function);
+
     static bool IsColliding(Body* a, Body* b, std::vector <Contact> &contacts);
+
+    // Like IsColliding, but separated shapes closer than margin also get a contact with a negative depth
+    // (speculative contact) so the solver can stop them before they pass through each other
+    static bool IsCollidingSpeculative(Body* a, Body* b, float margin, std::vector<Contact> &contacts);
+
     static bool IsCollidingCircleCircle(Body* a, Body* b, std::vector<Contact> &contacts);
     static bool IsCollidingPolygonPolygon(Body* a, Body* b, std::vector<Contact> &contacts);
+    static bool IsCollidingBoxBox(Body* a, Body* b, std::vector<Contact> &contacts);
     static bool IsCollidingPolygonCircle(Body* polygon, Body* circle, std::vector<Contact> &contacts);
+    static bool IsCollidingCapsuleCircle(Body* capsule, Body* circle, std::vector<Contact> &contacts);
+    static bool IsCollidingCapsuleCapsule(Body* a, Body* b, std::vector<Contact> &contacts);
+    static bool IsCollidingCapsulePolygon(Body* capsule, Body* polygon, std::vector<Contact> &contacts);
+    static bool IsCollidingChainCircle(Body* chain, Body* circle, std::vector<Contact> &contacts);
+    static bool IsCollidingChainPolygon(Body* chain, Body* polygon, std::vector<Contact> &contacts);
+    static bool IsCollidingChainCapsule(Body* chain, Body* capsule, std::vector<Contact> &contacts);
+
+    // Generic GJK/EPA collider, used for every convex shape pair without a dedicated routine
+    static bool IsCollidingConvex(Body* a, Body* b, std::vector<Contact> &contacts);
+
+    // Closest points and distance between two bodies, warm started from the previous query of the pair
+    static void GetDistance(Body* a, Body* b, DistanceOutput& output);
+
+    // Whether the shapes of two bodies touch or overlap, without building any contact (used for sensors)
+    static bool IsOverlapping(Body* a, Body* b);
+
+    // Deepest contact of a circle probe body moved to center with the given radius, against body (particle systems).
+    // contacts is scratch space. False when they don't overlap
+    static bool GetDeepestProbeContact(Body* body, Body* probe, const Vec2& center, float radius, std::vector<Contact> &contacts, Contact& outContact);
+
+    // Conservative advancement of a shape at (position, angle) moving by translation and rotation against a shape at rest.
+    // Returns the fraction of the motion at which they come within a small separation, with the closest points there.
+    // The shape is left at its start pose.
+    static bool TimeOfImpact(Shape& shape, const Vec2& position, float angle, const Vec2& translation, float rotation, const Shape& target, float& outFraction, DistanceOutput& outDistance);
+    static bool TimeOfImpact(Body* body, const Vec2& translation, float rotation, const Shape& target, float& outFraction, DistanceOutput& outDistance);
 };
 
 
@@ -1,8 +1,10 @@
 #include "Constraint.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include "./Body.h"
+#include "Constants.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Mat6x6 with the all inverse mass and inverse I of bodies "a" and "b"
@@ -135,6 +137,463 @@ void JointConstraint::Solve() {
 
 void JointConstraint::PostSolve() {}
 
+namespace {
+    // Baumgarte stabilization of the limits
+    constexpr float LIMIT_BETA = 0.2f;
+
+    // Position errors the position passes leave alone, in pixels and radians
+    constexpr float LINEAR_SLOP = 0.25f;
+    constexpr float ANGULAR_SLOP = 2.0f / 180.0f * 3.14159265f;
+
+    // Velocity of the point at r from the center of the body
+    Vec2 GetPointVelocity(const Body* body, const Vec2& r) {
+        return body->velocity + Vec2(-body->angularVelocity * r.y, body->angularVelocity * r.x);
+    }
+
+    // Equal and opposite impulse at the anchors, the torques on each body get the extra angular impulse
+    void ApplyJointImpulse(Body* a, Body* b, const Vec2& ra, const Vec2& rb, const Vec2& impulse, float angularImpulse) {
+        a->ApplyImpulseLinear(Vec2(-impulse.x, -impulse.y));
+        a->ApplyImpulseAngular(-(ra.Cross(impulse) + angularImpulse));
+        b->ApplyImpulseLinear(impulse);
+        b->ApplyImpulseAngular(rb.Cross(impulse) + angularImpulse);
+    }
+
+    // Same as a joint impulse but moving the bodies, their velocities are left alone
+    void ApplyPositionImpulse(Body* a, Body* b, const Vec2& ra, const Vec2& rb, const Vec2& impulse, float angularImpulse) {
+        a->position -= impulse * a->inverseMass;
+        a->rotation -= a->inverseI * (ra.Cross(impulse) + angularImpulse);
+        b->position += impulse * b->inverseMass;
+        b->rotation += b->inverseI * (rb.Cross(impulse) + angularImpulse);
+        a->shape->UpdateVertices(a->rotation, a->position);
+        b->shape->UpdateVertices(b->rotation, b->position);
+    }
+
+    // Effective mass of a point shared by both bodies, K = (1/ma + 1/mb) I + skew terms of the arms
+    Mat22 GetPointMass(const Body* a, const Body* b, const Vec2& ra, const Vec2& rb) {
+        const float mA = a->inverseMass, mB = b->inverseMass;
+        const float iA = a->inverseI, iB = b->inverseI;
+        const float k12 = -iA * ra.x * ra.y - iB * rb.x * rb.y;
+        return Mat22(mA + mB + iA * ra.y * ra.y + iB * rb.y * rb.y, k12,
+                     k12, mA + mB + iA * ra.x * ra.x + iB * rb.x * rb.x);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // Effective mass of the anchor (rows 0, 1) and the relative rotation (row 2)
+    ///////////////////////////////////////////////////////////////////////////////
+    //  [ mA+mB + ra.y² iA + rb.y² iB   -ra.x ra.y iA - rb.x rb.y iB   -ra.y iA - rb.y iB ]
+    //  [ -ra.x ra.y iA - rb.x rb.y iB  mA+mB + ra.x² iA + rb.x² iB    ra.x iA + rb.x iB  ]
+    //  [ -ra.y iA - rb.y iB            ra.x iA + rb.x iB              iA + iB            ]
+    ///////////////////////////////////////////////////////////////////////////////
+    Mat33 GetWeldMass(const Body* a, const Body* b, const Vec2& ra, const Vec2& rb) {
+        const float iA = a->inverseI, iB = b->inverseI;
+        const Mat22 pointK = GetPointMass(a, b, ra, rb);
+        Mat33 K;
+        K.rows[0][0] = pointK.rows[0][0];
+        K.rows[0][1] = K.rows[1][0] = pointK.rows[0][1];
+        K.rows[1][1] = pointK.rows[1][1];
+        K.rows[0][2] = K.rows[2][0] = -ra.y * iA - rb.y * iB;
+        K.rows[1][2] = K.rows[2][1] = ra.x * iA + rb.x * iB;
+        K.rows[2][2] = iA + iB;
+        return K;
+    }
+
+    // Inverse of the weld mass. Bodies that both can't rotate make K singular, the weld then only holds the anchors
+    Mat33 GetWeldInverseMass(const Body* a, const Body* b, const Vec2& ra, const Vec2& rb) {
+        const Mat33 K = GetWeldMass(a, b, ra, rb);
+        if (K.rows[2][2] != 0.0f) return K.Inverse();
+
+        const Mat22 pointMass = GetPointMass(a, b, ra, rb).Inverse();
+        Mat33 inverse;
+        inverse.rows[0][0] = pointMass.rows[0][0];
+        inverse.rows[0][1] = pointMass.rows[0][1];
+        inverse.rows[1][0] = pointMass.rows[1][0];
+        inverse.rows[1][1] = pointMass.rows[1][1];
+        return inverse;
+    }
+
+    // Bias of a one sided limit, a limit still apart lets the bodies close the gap in this step
+    float GetLimitBias(float error, float deltaTime) {
+        return error > 0.0f ? error / deltaTime : (LIMIT_BETA / deltaTime) * error;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// RevoluteJoint
+///////////////////////////////////////////////////////////////////////////////
+RevoluteJoint::RevoluteJoint(Body *a, Body *b, const Vec2 &anchor) : Constraint() {
+    this->a = a;
+    this->b = b;
+    this->aPoint = a->GetLocalPoint(anchor);
+    this->bPoint = b->GetLocalPoint(anchor);
+    referenceAngle = b->rotation - a->rotation;
+}
+
+float RevoluteJoint::GetAngle() const {
+    return b->rotation - a->rotation - referenceAngle;
+}
+
+void RevoluteJoint::PreSolve(float deltaTime) {
+    this->deltaTime = deltaTime;
+    ra = a->GetWorldPoint(aPoint) - a->position;
+    rb = b->GetWorldPoint(bPoint) - b->position;
+
+    pointMass = GetPointMass(a, b, ra, rb).Inverse();
+    const float angularMass = a->inverseI + b->inverseI;
+    axialMass = angularMass > 0.0f ? 1.0f / angularMass : 0.0f;
+
+    const float angle = GetAngle();
+    lowerError = angle - lowerAngle;
+    upperError = upperAngle - angle;
+
+    if (!isMotorEnabled) motorImpulse = 0.0f;
+    if (!isLimitEnabled) lowerImpulse = upperImpulse = 0.0f;
+
+    // Warm start with the impulses of the last step
+    ApplyJointImpulse(a, b, ra, rb, impulse, motorImpulse + lowerImpulse - upperImpulse);
+}
+
+void RevoluteJoint::Solve() {
+    const bool isRotating = axialMass > 0.0f;
+
+    if (isMotorEnabled && isRotating) {
+        const float Cdot = b->angularVelocity - a->angularVelocity - motorSpeed;
+        const float maxImpulse = maxMotorTorque * deltaTime;
+        const float oldImpulse = motorImpulse;
+        motorImpulse = std::clamp(motorImpulse - axialMass * Cdot, -maxImpulse, maxImpulse);
+        ApplyJointImpulse(a, b, ra, rb, Vec2(), motorImpulse - oldImpulse);
+    }
+
+    if (isLimitEnabled && isRotating) {
+        // Lower limit pushes b forward, upper limit pushes it back
+        float Cdot = b->angularVelocity - a->angularVelocity;
+        float oldImpulse = lowerImpulse;
+        lowerImpulse = std::max(0.0f, lowerImpulse - axialMass * (Cdot + GetLimitBias(lowerError, deltaTime)));
+        ApplyJointImpulse(a, b, ra, rb, Vec2(), lowerImpulse - oldImpulse);
+
+        Cdot = a->angularVelocity - b->angularVelocity;
+        oldImpulse = upperImpulse;
+        upperImpulse = std::max(0.0f, upperImpulse - axialMass * (Cdot + GetLimitBias(upperError, deltaTime)));
+        ApplyJointImpulse(a, b, ra, rb, Vec2(), -(upperImpulse - oldImpulse));
+    }
+
+    // Both axes of the anchor at once
+    const Vec2 Cdot = GetPointVelocity(b, rb) - GetPointVelocity(a, ra);
+    const Vec2 lambda = pointMass * Vec2(-Cdot.x, -Cdot.y);
+    impulse += lambda;
+    ApplyJointImpulse(a, b, ra, rb, lambda, 0.0f);
+}
+
+bool RevoluteJoint::SolvePosition() {
+    const Vec2 pa = a->GetWorldPoint(aPoint);
+    const Vec2 pb = b->GetWorldPoint(bPoint);
+    const Vec2 ra = pa - a->position;
+    const Vec2 rb = pb - b->position;
+
+    const Vec2 C = pb - pa;
+    const Vec2 P = GetPointMass(a, b, ra, rb).Solve(Vec2(-C.x, -C.y));
+    ApplyPositionImpulse(a, b, ra, rb, P, 0.0f);
+    return C.MagnitudeSquared() <= LINEAR_SLOP * LINEAR_SLOP;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DistanceJoint
+///////////////////////////////////////////////////////////////////////////////
+DistanceJoint::DistanceJoint(Body *a, Body *b, const Vec2 &anchorA, const Vec2 &anchorB) : Constraint() {
+    this->a = a;
+    this->b = b;
+    this->aPoint = a->GetLocalPoint(anchorA);
+    this->bPoint = b->GetLocalPoint(anchorB);
+    length = (anchorB - anchorA).Magnitude();
+}
+
+void DistanceJoint::PreSolve(float deltaTime) {
+    this->deltaTime = deltaTime;
+    const Vec2 pa = a->GetWorldPoint(aPoint);
+    const Vec2 pb = b->GetWorldPoint(bPoint);
+    ra = pa - a->position;
+    rb = pb - b->position;
+
+    const float distance = (pb - pa).Magnitude();
+    axis = distance > 0.0f ? (pb - pa) / distance : Vec2(0.0f, 0.0f);
+
+    const float crA = ra.Cross(axis);
+    const float crB = rb.Cross(axis);
+    const float k = a->inverseMass + b->inverseMass + a->inverseI * crA * crA + b->inverseI * crB * crB;
+    mass = k > 0.0f ? 1.0f / k : 0.0f;
+
+    ApplyJointImpulse(a, b, ra, rb, axis * impulse, 0.0f);
+}
+
+void DistanceJoint::Solve() {
+    const float Cdot = axis.Dot(GetPointVelocity(b, rb) - GetPointVelocity(a, ra));
+    const float lambda = -mass * Cdot;
+    impulse += lambda;
+    ApplyJointImpulse(a, b, ra, rb, axis * lambda, 0.0f);
+}
+
+bool DistanceJoint::SolvePosition() {
+    const Vec2 pa = a->GetWorldPoint(aPoint);
+    const Vec2 pb = b->GetWorldPoint(bPoint);
+    const Vec2 ra = pa - a->position;
+    const Vec2 rb = pb - b->position;
+
+    const float distance = (pb - pa).Magnitude();
+    if (distance == 0.0f) return true;
+    const Vec2 u = (pb - pa) / distance;
+
+    const float crA = ra.Cross(u);
+    const float crB = rb.Cross(u);
+    const float k = a->inverseMass + b->inverseMass + a->inverseI * crA * crA + b->inverseI * crB * crB;
+    const float C = distance - length;
+    if (k > 0.0f)
+        ApplyPositionImpulse(a, b, ra, rb, u * (-C / k), 0.0f);
+    return std::abs(C) <= LINEAR_SLOP;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PrismaticJoint
+///////////////////////////////////////////////////////////////////////////////
+PrismaticJoint::PrismaticJoint(Body *a, Body *b, const Vec2 &anchor, const Vec2 &axis) : Constraint() {
+    this->a = a;
+    this->b = b;
+    this->aPoint = a->GetLocalPoint(anchor);
+    this->bPoint = b->GetLocalPoint(anchor);
+    localAxis = axis.UnitVector().Rotate(-a->rotation);
+    referenceAngle = b->rotation - a->rotation;
+}
+
+float PrismaticJoint::GetTranslation() const {
+    return localAxis.Rotate(a->rotation).Dot(b->GetWorldPoint(bPoint) - a->GetWorldPoint(aPoint));
+}
+
+void PrismaticJoint::ApplyAxialImpulse(float impulse) {
+    a->ApplyImpulseLinear(axis * -impulse);
+    a->ApplyImpulseAngular(-impulse * a1);
+    b->ApplyImpulseLinear(axis * impulse);
+    b->ApplyImpulseAngular(impulse * a2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Effective mass across the axis (row 0) and of the relative rotation (row 1)
+///////////////////////////////////////////////////////////////////////////////
+//  [ mA+mB + iA s1² + iB s2²   iA s1 + iB s2 ]
+//  [ iA s1 + iB s2             iA + iB       ]
+///////////////////////////////////////////////////////////////////////////////
+void PrismaticJoint::PreSolve(float deltaTime) {
+    this->deltaTime = deltaTime;
+    const Vec2 pa = a->GetWorldPoint(aPoint);
+    const Vec2 pb = b->GetWorldPoint(bPoint);
+    ra = pa - a->position;
+    rb = pb - b->position;
+    const Vec2 d = pb - pa;
+
+    // The arms of a reach the anchor on b, the axis turns with a
+    axis = localAxis.Rotate(a->rotation);
+    perpendicular = Vec2(-axis.y, axis.x);
+    a1 = (d + ra).Cross(axis);
+    a2 = rb.Cross(axis);
+    s1 = (d + ra).Cross(perpendicular);
+    s2 = rb.Cross(perpendicular);
+
+    const float mA = a->inverseMass, mB = b->inverseMass;
+    const float iA = a->inverseI, iB = b->inverseI;
+    const float k = mA + mB + iA * a1 * a1 + iB * a2 * a2;
+    axialMass = k > 0.0f ? 1.0f / k : 0.0f;
+
+    // Bodies that can't rotate only keep the first row
+    const float k12 = iA * s1 + iB * s2;
+    float k22 = iA + iB;
+    if (k22 == 0.0f) k22 = 1.0f;
+    pointMass = Mat22(mA + mB + iA * s1 * s1 + iB * s2 * s2, k12, k12, k22).Inverse();
+
+    const float translation = axis.Dot(d);
+    lowerError = translation - lowerTranslation;
+    upperError = upperTranslation - translation;
+
+    if (!isMotorEnabled) motorImpulse = 0.0f;
+    if (!isLimitEnabled) lowerImpulse = upperImpulse = 0.0f;
+
+    // Warm start with the impulses of the last step
+    const float axialImpulse = motorImpulse + lowerImpulse - upperImpulse;
+    const Vec2 P = perpendicular * impulse.x + axis * axialImpulse;
+    a->ApplyImpulseLinear(Vec2(-P.x, -P.y));
+    a->ApplyImpulseAngular(-(impulse.x * s1 + impulse.y + axialImpulse * a1));
+    b->ApplyImpulseLinear(P);
+    b->ApplyImpulseAngular(impulse.x * s2 + impulse.y + axialImpulse * a2);
+}
+
+void PrismaticJoint::Solve() {
+    auto getAxialVelocity = [&]() {
+        return axis.Dot(b->velocity - a->velocity) + a2 * b->angularVelocity - a1 * a->angularVelocity;
+    };
+
+    if (isMotorEnabled) {
+        const float maxImpulse = maxMotorForce * deltaTime;
+        const float oldImpulse = motorImpulse;
+        motorImpulse = std::clamp(motorImpulse + axialMass * (motorSpeed - getAxialVelocity()), -maxImpulse, maxImpulse);
+        ApplyAxialImpulse(motorImpulse - oldImpulse);
+    }
+
+    if (isLimitEnabled) {
+        float oldImpulse = lowerImpulse;
+        lowerImpulse = std::max(0.0f, lowerImpulse - axialMass * (getAxialVelocity() + GetLimitBias(lowerError, deltaTime)));
+        ApplyAxialImpulse(lowerImpulse - oldImpulse);
+
+        oldImpulse = upperImpulse;
+        upperImpulse = std::max(0.0f, upperImpulse - axialMass * (-getAxialVelocity() + GetLimitBias(upperError, deltaTime)));
+        ApplyAxialImpulse(-(upperImpulse - oldImpulse));
+    }
+
+    // Across the axis and the rotation at once
+    const Vec2 Cdot(perpendicular.Dot(b->velocity - a->velocity) + s2 * b->angularVelocity - s1 * a->angularVelocity,
+                    b->angularVelocity - a->angularVelocity);
+    const Vec2 lambda = pointMass * Vec2(-Cdot.x, -Cdot.y);
+    impulse += lambda;
+
+    const Vec2 P = perpendicular * lambda.x;
+    a->ApplyImpulseLinear(Vec2(-P.x, -P.y));
+    a->ApplyImpulseAngular(-(lambda.x * s1 + lambda.y));
+    b->ApplyImpulseLinear(P);
+    b->ApplyImpulseAngular(lambda.x * s2 + lambda.y);
+}
+
+bool PrismaticJoint::SolvePosition() {
+    const Vec2 pa = a->GetWorldPoint(aPoint);
+    const Vec2 pb = b->GetWorldPoint(bPoint);
+    const Vec2 ra = pa - a->position;
+    const Vec2 rb = pb - b->position;
+    const Vec2 d = pb - pa;
+
+    const Vec2 axis = localAxis.Rotate(a->rotation);
+    const Vec2 perpendicular(-axis.y, axis.x);
+    const float s1 = (d + ra).Cross(perpendicular);
+    const float s2 = rb.Cross(perpendicular);
+
+    const float mA = a->inverseMass, mB = b->inverseMass;
+    const float iA = a->inverseI, iB = b->inverseI;
+    const float k12 = iA * s1 + iB * s2;
+    float k22 = iA + iB;
+    if (k22 == 0.0f) k22 = 1.0f;
+    const Mat22 K(mA + mB + iA * s1 * s1 + iB * s2 * s2, k12, k12, k22);
+
+    const Vec2 C(perpendicular.Dot(d), b->rotation - a->rotation - referenceAngle);
+    const Vec2 lambda = K.Solve(Vec2(-C.x, -C.y));
+
+    // Same as a joint impulse, with the lever arm of a reaching the anchor on b
+    const Vec2 P = perpendicular * lambda.x;
+    a->position -= P * mA;
+    a->rotation -= iA * (lambda.x * s1 + lambda.y);
+    b->position += P * mB;
+    b->rotation += iB * (lambda.x * s2 + lambda.y);
+    a->shape->UpdateVertices(a->rotation, a->position);
+    b->shape->UpdateVertices(b->rotation, b->position);
+    return std::abs(C.x) <= LINEAR_SLOP && std::abs(C.y) <= ANGULAR_SLOP;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// WeldJoint
+///////////////////////////////////////////////////////////////////////////////
+WeldJoint::WeldJoint(Body *a, Body *b, const Vec2 &anchor) : Constraint() {
+    this->a = a;
+    this->b = b;
+    this->aPoint = a->GetLocalPoint(anchor);
+    this->bPoint = b->GetLocalPoint(anchor);
+    referenceAngle = b->rotation - a->rotation;
+}
+
+void WeldJoint::PreSolve(float deltaTime) {
+    ra = a->GetWorldPoint(aPoint) - a->position;
+    rb = b->GetWorldPoint(bPoint) - b->position;
+    mass = GetWeldInverseMass(a, b, ra, rb);
+
+    ApplyJointImpulse(a, b, ra, rb, Vec2(impulse[0], impulse[1]), impulse[2]);
+}
+
+void WeldJoint::Solve() {
+    const Vec2 pointVelocity = GetPointVelocity(b, rb) - GetPointVelocity(a, ra);
+    const float Cdot[3] = {
+        -pointVelocity.x,
+        -pointVelocity.y,
+        -(b->angularVelocity - a->angularVelocity)
+    };
+    float lambda[3];
+    mass.Multiply(Cdot, lambda);
+    for (int i = 0; i < 3; i++)
+        impulse[i] += lambda[i];
+
+    ApplyJointImpulse(a, b, ra, rb, Vec2(lambda[0], lambda[1]), lambda[2]);
+}
+
+bool WeldJoint::SolvePosition() {
+    const Vec2 pa = a->GetWorldPoint(aPoint);
+    const Vec2 pb = b->GetWorldPoint(bPoint);
+    const Vec2 ra = pa - a->position;
+    const Vec2 rb = pb - b->position;
+
+    const Vec2 C = pb - pa;
+    const float angularC = b->rotation - a->rotation - referenceAngle;
+    const float error[3] = { -C.x, -C.y, -angularC };
+    float lambda[3];
+    GetWeldInverseMass(a, b, ra, rb).Multiply(error, lambda);
+
+    ApplyPositionImpulse(a, b, ra, rb, Vec2(lambda[0], lambda[1]), lambda[2]);
+    return C.MagnitudeSquared() <= LINEAR_SLOP * LINEAR_SLOP && std::abs(angularC) <= ANGULAR_SLOP;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MouseJoint
+///////////////////////////////////////////////////////////////////////////////
+MouseJoint::MouseJoint(Body *body, const Vec2 &target) : Constraint(), target(target) {
+    this->a = body;
+    this->b = body;
+    this->aPoint = body->GetLocalPoint(target);
+    this->bPoint = this->aPoint;
+    maxForce = 1000.0f * body->mass * PIXELS_PER_METER;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Soft constraint of a spring with the given frequency and damping ratio
+// on the mass of the body: gamma softens the effective mass and beta is
+// the share of the error fed back each step, both from the implicit step
+// of the spring (k = m ω², c = 2 m ζ ω).
+///////////////////////////////////////////////////////////////////////////////
+void MouseJoint::PreSolve(float deltaTime) {
+    this->deltaTime = deltaTime;
+    rb = b->GetWorldPoint(bPoint) - b->position;
+
+    const float pi = 3.14159265f;
+    const float omega = 2.0f * pi * frequency;
+    const float damping = 2.0f * b->mass * dampingRatio * omega;
+    const float stiffness = b->mass * omega * omega;
+    gamma = deltaTime * (damping + deltaTime * stiffness);
+    gamma = gamma != 0.0f ? 1.0f / gamma : 0.0f;
+    const float beta = deltaTime * stiffness * gamma;
+
+    const float mB = b->inverseMass, iB = b->inverseI;
+    const float k12 = -iB * rb.x * rb.y;
+    mass = Mat22(mB + iB * rb.y * rb.y + gamma, k12, k12, mB + iB * rb.x * rb.x + gamma).Inverse();
+    bias = (b->position + rb - target) * beta;
+
+    b->ApplyImpulseLinear(impulse);
+    b->ApplyImpulseAngular(rb.Cross(impulse));
+}
+
+void MouseJoint::Solve() {
+    const Vec2 Cdot = GetPointVelocity(b, rb) + bias + impulse * gamma;
+    Vec2 lambda = mass * Vec2(-Cdot.x, -Cdot.y);
+
+    // The pull is capped by the max force
+    const Vec2 oldImpulse = impulse;
+    impulse += lambda;
+    const float maxImpulse = maxForce * deltaTime;
+    if (impulse.MagnitudeSquared() > maxImpulse * maxImpulse)
+        impulse *= maxImpulse / impulse.Magnitude();
+    lambda = impulse - oldImpulse;
+
+    b->ApplyImpulseLinear(lambda);
+    b->ApplyImpulseAngular(rb.Cross(lambda));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // PenerationConstraint
 ///////////////////////////////////////////////////////////////////////////////
@@ -145,12 +604,26 @@ PenetrationConstraint::PenetrationConstraint() : Constraint() {
 PenetrationConstraint::PenetrationConstraint(Body* a, Body* b, const Vec2& aCollisionPoint, const Vec2& bCollisionPoint, const Vec2& normal) : Constraint() {
     this->a = a;
     this->b = b;
+    this->inverseIA = a->inverseI;
+    this->inverseIB = b->inverseI;
     this->aPoint = a->GetLocalPoint(aCollisionPoint);
     this->bPoint = b->GetLocalPoint(bCollisionPoint);
     this->normal = a->GetLocalPoint(normal);
     cachedLambda.Zero();
 }
 
+void PenetrationConstraint::SetInverseI(float inverseIA, float inverseIB) {
+    this->inverseIA = inverseIA;
+    this->inverseIB = inverseIB;
+}
+
+void PenetrationConstraint::ApplyImpulses(const VecN& impulses) {
+    a->ApplyImpulseLinear(Vec2(impulses[0], impulses[1])); // A linear impulse
+    b->ApplyImpulseLinear(Vec2(impulses[3], impulses[4])); // B linear impulse
+    if (!a->IsStatic()) a->angularVelocity += impulses[2] * inverseIA;  // A angular impulse
+    if (!b->IsStatic()) b->angularVelocity += impulses[5] * inverseIB;  // B angular impulse
+}
+
 void PenetrationConstraint::PreSolve(float deltaTime) {
     // Get the anchor point position in world space
     const Vec2 pa = a->GetWorldPoint(aPoint);
@@ -193,29 +666,44 @@ void PenetrationConstraint::PreSolve(float deltaTime) {
     VecN impulses = Jt * cachedLambda;
 
     // Apply the impulses to both A and B
-    a->ApplyImpulseLinear(Vec2(impulses[0], impulses[1])); // A linear impulse
-    a->ApplyImpulseAngular(impulses[2]);                   // A angular impulse
-    b->ApplyImpulseLinear(Vec2(impulses[3], impulses[4])); // B linear impulse
-    b->ApplyImpulseAngular(impulses[5]);                   // B angular impulse
+    ApplyImpulses(impulses);
 
     // Compute the bias (baumgarte stabilization)
     static float beta = 0.1f;
-    float C = (pb - pa).Dot(-n);                           // Positional error
-    C = std::min(0.0f, C + 0.01f);                         // Clamp the error
+    float C = (pb - pa).Dot(-n);                           // Positional error, positive while separated
     
     Vec2 va = a->velocity + Vec2(-a->angularVelocity * ra.y, a->angularVelocity * ra.x);
     Vec2 vb = b->velocity + Vec2(-b->angularVelocity * rb.y, b->angularVelocity * rb.x);
     float vrelDotNormal = (va - vb).Dot(n);                // Relative velocity
     
     float e = std::min(a->restitution, b->restitution);    // Restitution
+
+    // Resting contacts (slow approach) don't bounce, otherwise gravity keeps them jittering
+    if (vrelDotNormal < 1.0f * PIXELS_PER_METER) e = 0.0f;
+
+    // The bounce reflects the approach speed from before this step's forces, reflecting the
+    // integrated one would lift a dropped body by one step of gravity on every bounce
+    Vec2 aa = a->acceleration + Vec2(-a->angularAcceleration * ra.y, a->angularAcceleration * ra.x);
+    Vec2 ab = b->acceleration + Vec2(-b->angularAcceleration * rb.y, b->angularAcceleration * rb.x);
+    float bounce = e * std::max(0.0f, vrelDotNormal - (aa - ab).Dot(n) * deltaTime);
+
+    // Speculative contact, the bodies may approach until the gap closes
+    if (C > 0.0f) {
+        const bool isClosing = vrelDotNormal * deltaTime > C;
+        bias = (isClosing && bounce > 0.0f) ? -bounce : C / deltaTime;
+        return;
+    }
+    C = std::min(0.0f, C + 0.01f);                         // Clamp the error
     
-    // Bias term relative to restitution
-    bias = (beta / deltaTime) * C + (e * vrelDotNormal);
+    // The bounce is a separating velocity, Baumgarte only takes over when it pushes harder (adding both gains energy)
+    bias = std::min((beta / deltaTime) * C, -bounce);
 }
 
 void PenetrationConstraint::Solve() {
     const VecN V = GetVelocities();
-    const MatMN invM = GetInvMassMatrix();
+    MatMN invM = GetInvMassMatrix();
+    invM.rows[2][2] = inverseIA;
+    invM.rows[5][5] = inverseIB;
 
     const MatMN J = jacobian;
     const MatMN Jt = jacobian.Transpose();
@@ -245,10 +733,7 @@ void PenetrationConstraint::Solve() {
     VecN impulses = Jt * lambda;
 
     // Apply the impulses to both A and B
-    a->ApplyImpulseLinear(Vec2(impulses[0], impulses[1])); // A linear impulse
-    a->ApplyImpulseAngular(impulses[2]);                   // A angular impulse
-    b->ApplyImpulseLinear(Vec2(impulses[3], impulses[4])); // B linear impulse
-    b->ApplyImpulseAngular(impulses[5]);                   // B angular impulse
+    ApplyImpulses(impulses);
 }
 
 void PenetrationConstraint::PostSolve() {}
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define CONSTRAINT_H
 
 #include "./Math/Vec2.h"
+#include "./Math/Mat22.h"
+#include "./Math/Mat33.h"
 #include "./Math/MatMN.h"
 
 // Forward declaration
@@ -24,6 +26,9 @@ public:
     virtual void PreSolve(float deltaTime) {}
     virtual void Solve() {}
     virtual void PostSolve() {}
+
+    // Moves the bodies to close the error left after they were integrated, true when within tolerance
+    virtual bool SolvePosition() { return true; }
 };
 
 class JointConstraint : public Constraint
@@ -42,6 +47,154 @@ public:
     void PostSolve() override;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Joints with a fixed size effective mass, computed once per step in PreSolve.
+// Their drift is closed by SolvePosition instead of a velocity bias, only the
+// limits are pushed apart by their velocity. Angles are the rotation of b
+// relative to a, from the one at creation
+///////////////////////////////////////////////////////////////////////////////
+
+// Pins the bodies together at an anchor, both axes solved at once.
+// The relative angle can be limited and driven by a motor
+class RevoluteJoint : public Constraint
+{
+private:
+    float referenceAngle = 0.0f;
+    float deltaTime = 0.0f;
+    Vec2 ra{}, rb{};
+    Mat22 pointMass{};          // Inverse of the effective mass of the anchor
+    float axialMass = 0.0f;     // Effective mass of the relative rotation
+    float lowerError = 0.0f, upperError = 0.0f;
+
+    Vec2 impulse{};
+    float motorImpulse = 0.0f;
+    float lowerImpulse = 0.0f, upperImpulse = 0.0f;
+
+public:
+    RevoluteJoint(Body* a, Body* b, const Vec2& anchor);
+
+    bool isLimitEnabled = false;
+    float lowerAngle = 0.0f;
+    float upperAngle = 0.0f;
+
+    bool isMotorEnabled = false;
+    float motorSpeed = 0.0f;        // Target relative angular velocity, in radians per second
+    float maxMotorTorque = 0.0f;
+
+    float GetAngle() const;
+    float GetMotorImpulse() const { return motorImpulse; }
+
+    void PreSolve(float deltaTime) override;
+    void Solve() override;
+    bool SolvePosition() override;
+};
+
+// Keeps the anchors of the bodies at a fixed distance, the bodies are free to rotate around them
+class DistanceJoint : public Constraint
+{
+private:
+    float deltaTime = 0.0f;
+    Vec2 ra{}, rb{};
+    Vec2 axis{};                // Unit vector from the anchor on a to the anchor on b
+    float mass = 0.0f;
+    float impulse = 0.0f;
+
+public:
+    // The length is the distance between the anchors
+    DistanceJoint(Body* a, Body* b, const Vec2& anchorA, const Vec2& anchorB);
+
+    float length = 0.0f;
+
+    void PreSolve(float deltaTime) override;
+    void Solve() override;
+    bool SolvePosition() override;
+};
+
+// Lets b slide along an axis fixed in a without rotating relative to it.
+// The translation along the axis can be limited and driven by a motor
+class PrismaticJoint : public Constraint
+{
+private:
+    Vec2 localAxis{};           // Axis in the local space of a
+    float referenceAngle = 0.0f;
+    float deltaTime = 0.0f;
+    Vec2 ra{}, rb{};
+    Vec2 axis{}, perpendicular{};
+    float a1 = 0.0f, a2 = 0.0f; // Lever arms of a and b along the axis
+    float s1 = 0.0f, s2 = 0.0f; // Lever arms of a and b across the axis
+    Mat22 pointMass{};          // Inverse of the effective mass across the axis and of the rotation
+    float axialMass = 0.0f;     // Effective mass along the axis
+    float lowerError = 0.0f, upperError = 0.0f;
+
+    Vec2 impulse{};
+    float motorImpulse = 0.0f;
+    float lowerImpulse = 0.0f, upperImpulse = 0.0f;
+
+    // Impulse along the axis
+    void ApplyAxialImpulse(float impulse);
+
+public:
+    PrismaticJoint(Body* a, Body* b, const Vec2& anchor, const Vec2& axis);
+
+    bool isLimitEnabled = false;
+    float lowerTranslation = 0.0f;
+    float upperTranslation = 0.0f;
+
+    bool isMotorEnabled = false;
+    float motorSpeed = 0.0f;        // Target relative speed along the axis
+    float maxMotorForce = 0.0f;
+
+    // Translation of the anchor on b along the axis, from the anchor on a
+    float GetTranslation() const;
+    float GetMotorImpulse() const { return motorImpulse; }
+
+    void PreSolve(float deltaTime) override;
+    void Solve() override;
+    bool SolvePosition() override;
+};
+
+// Glues the bodies together at an anchor, the point and the angle solved as one 3x3 block
+class WeldJoint : public Constraint
+{
+private:
+    float referenceAngle = 0.0f;
+    Vec2 ra{}, rb{};
+    Mat33 mass{};               // Inverse of the effective mass of the anchor and the rotation
+    float impulse[3] = {};
+
+public:
+    WeldJoint(Body* a, Body* b, const Vec2& anchor);
+
+    void PreSolve(float deltaTime) override;
+    void Solve() override;
+    bool SolvePosition() override;
+};
+
+// Pulls a point of a body towards a target with a soft spring, for dragging bodies around.
+// Both ends of the constraint are the body
+class MouseJoint : public Constraint
+{
+private:
+    float deltaTime = 0.0f;
+    Vec2 rb{};
+    Mat22 mass{};
+    Vec2 bias{};
+    float gamma = 0.0f;         // Softness of the spring
+    Vec2 impulse{};
+
+public:
+    // Grabs the body at the target
+    MouseJoint(Body* body, const Vec2& target);
+
+    Vec2 target{};
+    float frequency = 5.0f;         // Of the spring, in Hz
+    float dampingRatio = 0.7f;
+    float maxForce = 0.0f;          // Defaults to about a hundred times the weight of the body
+
+    void PreSolve(float deltaTime) override;
+    void Solve() override;
+};
+
 class PenetrationConstraint : public Constraint
 {
 private:
@@ -50,14 +203,27 @@ private:
     float bias = 0.0f;
     float friction = 0.0f;      // Friction coefficient
     Vec2 normal{};              // Normal of the collision
+    float inverseIA = 0.0f;     // Inverse rotational masses the contact works with
+    float inverseIB = 0.0f;
+
+    // Impulses of both bodies, in the order of the jacobian columns
+    void ApplyImpulses(const VecN& impulses);
 
 public:
     PenetrationConstraint();
     PenetrationConstraint(Body* a, Body* b, const Vec2& aCollisionPoint, const Vec2& bCollisionPoint, const Vec2& normal);
 
+    // Rotational masses to use in place of the ones of the bodies, from a solver that stiffens them for the step.
+    // Set before PreSolve
+    void SetInverseI(float inverseIA, float inverseIB);
+
     void PreSolve(float deltaTime) override;
     void Solve() override;
     void PostSolve() override;
+
+    // Impulses accumulated along the normal and the tangent, valid after solving
+    float GetNormalImpulse() const { return cachedLambda[0]; }
+    float GetTangentImpulse() const { return cachedLambda[1]; }
 };
 
 #endif
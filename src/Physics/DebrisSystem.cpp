@@ -0,0 +1,169 @@
+#include "DebrisSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "./Body.h"
+#include "./World.h"
+
+DebrisSystem::DebrisSystem(int maxParticles, float cellSize) : maxParticles(maxParticles) {
+    grid.cellSize = cellSize;
+}
+
+bool DebrisSystem::Spawn(const Vec2 &position, const Vec2 &velocity, float radius, float lifetime) {
+    if (GetParticleCount() >= maxParticles) return false;
+
+    x.push_back(position.x);
+    y.push_back(position.y);
+    vx.push_back(velocity.x);
+    vy.push_back(velocity.y);
+    radii.push_back(radius);
+    lifetimes.push_back(lifetime);
+    return true;
+}
+
+void DebrisSystem::Clear() {
+    x.clear();
+    y.clear();
+    vx.clear();
+    vy.clear();
+    radii.clear();
+    lifetimes.clear();
+}
+
+// Expired particles are overwritten by the last live one, so the arrays stay packed
+void DebrisSystem::RemoveExpired() {
+    int count = GetParticleCount();
+    for (int i = 0; i < count;) {
+        if (lifetimes[i] > 0.0f) {
+            i++;
+            continue;
+        }
+
+        count--;
+        x[i] = x[count];
+        y[i] = y[count];
+        vx[i] = vx[count];
+        vy[i] = vy[count];
+        radii[i] = radii[count];
+        lifetimes[i] = lifetimes[count];
+    }
+
+    x.resize(count);
+    y.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+    radii.resize(count);
+    lifetimes.resize(count);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A particle that went through the surface of the body during the step is
+// stopped where the sweep of its center hits it, then a particle overlapping
+// the body is pushed out along the deepest contact. Either way the speed
+// into the body, relative to the body's own motion at that point, bounces
+// back scaled by the restitution and the sliding speed loses its friction share.
+///////////////////////////////////////////////////////////////////////////////
+void DebrisSystem::Collide(int i, Body *body) {
+    Vec2 normal;
+    bool isHit = false;
+
+    const Vec2 start(startX[i], startY[i]);
+    const Vec2 end(x[i], y[i]);
+    RayCastOutput ray;
+    if ((end - start).MagnitudeSquared() > radii[i] * radii[i] && !body->shape->TestPoint(start) &&
+        body->shape->RayCast(start, end, 1.0f, ray)) {
+        const Vec2 point = start + (end - start) * ray.fraction;
+        x[i] = point.x + ray.normal.x * radii[i];
+        y[i] = point.y + ray.normal.y * radii[i];
+        normal = ray.normal;
+        isHit = true;
+    }
+
+    Contact contact;
+    if (collider.GetDeepestContact(body, Vec2(x[i], y[i]), radii[i], contact)) {
+        x[i] += contact.normal.x * contact.depth;
+        y[i] += contact.normal.y * contact.depth;
+        normal = contact.normal;
+        isHit = true;
+    }
+    if (!isHit) return;
+
+    const Vec2 arm = Vec2(x[i], y[i]) - body->position;
+    const Vec2 bodyVelocity = body->velocity + Vec2(-body->angularVelocity * arm.y, body->angularVelocity * arm.x);
+    const Vec2 relative = Vec2(vx[i], vy[i]) - bodyVelocity;
+    const float normalSpeed = relative.Dot(normal);
+    if (normalSpeed >= 0.0f) return;
+
+    const Vec2 tangent = relative - normal * normalSpeed;
+    const Vec2 response = normal * (-restitution * normalSpeed) + tangent * (1.0f - friction) + bodyVelocity;
+    vx[i] = response.x;
+    vy[i] = response.y;
+}
+
+void DebrisSystem::Step(float deltaTime, const Vec2 &gravity, World &world) {
+    if (deltaTime <= 0.0f) return;
+
+    for (float& lifetime: lifetimes)
+        lifetime -= deltaTime;
+    RemoveExpired();
+
+    const int count = GetParticleCount();
+    if (count == 0) return;
+
+    // Integrate, keeping the bounds of the whole motion for the body query
+    startX = x;
+    startY = y;
+    const Vec2 acceleration = gravity * gravityScale;
+    float maxReach = 0.0f;
+    AABB bounds(Vec2(x[0], y[0]), Vec2(x[0], y[0]));
+    for (int i = 0; i < count; i++) {
+        vx[i] += acceleration.x * deltaTime;
+        vy[i] += acceleration.y * deltaTime;
+        x[i] += vx[i] * deltaTime;
+        y[i] += vy[i] * deltaTime;
+
+        maxReach = std::max(maxReach, radii[i] + std::max(std::abs(vx[i]), std::abs(vy[i])) * deltaTime);
+        bounds.min = Vec2(std::min(bounds.min.x, x[i]), std::min(bounds.min.y, y[i]));
+        bounds.max = Vec2(std::max(bounds.max.x, x[i]), std::max(bounds.max.y, y[i]));
+    }
+    bounds = AABB(bounds.min - Vec2(maxReach, maxReach), bounds.max + Vec2(maxReach, maxReach));
+
+    bodies.clear();
+    collider.QueryBodies(world, bounds, bodies);
+    const int bodyCount = static_cast<int>(bodies.size());
+    if (bodyCount == 0) return;
+
+    grid.Build(x.data(), y.data(), count);
+    visitStamps.assign(count, -1);
+
+    // Each body visits the cells under its box grown by the longest reach of a particle this step
+    for (int b = 0; b < bodyCount; b++) {
+        Body* body = bodies[b];
+        const AABB bodyBox = body->shape->GetAABB();
+        const AABB box(Vec2(std::max(bodyBox.min.x - maxReach, bounds.min.x), std::max(bodyBox.min.y - maxReach, bounds.min.y)),
+                       Vec2(std::min(bodyBox.max.x + maxReach, bounds.max.x), std::min(bodyBox.max.y + maxReach, bounds.max.y)));
+        const int minCellX = grid.GetCell(box.min.x);
+        const int minCellY = grid.GetCell(box.min.y);
+        const int maxCellX = grid.GetCell(box.max.x);
+        const int maxCellY = grid.GetCell(box.max.y);
+
+        for (int cellY = minCellY; cellY <= maxCellY; cellY++) {
+            for (int cellX = minCellX; cellX <= maxCellX; cellX++) {
+                const int bucket = grid.GetBucket(cellX, cellY);
+                for (int c = grid.GetBucketStart(bucket); c < grid.GetBucketStart(bucket + 1); c++) {
+                    const int i = grid.GetPoint(c);
+                    if (visitStamps[i] == b) continue;
+                    visitStamps[i] = b;
+
+                    // Motion of the particle against the box of the body
+                    const float r = radii[i];
+                    if (std::max(x[i], startX[i]) + r < bodyBox.min.x || std::min(x[i], startX[i]) - r > bodyBox.max.x ||
+                        std::max(y[i], startY[i]) + r < bodyBox.min.y || std::min(y[i], startY[i]) - r > bodyBox.max.y) continue;
+
+                    Collide(i, body);
+                }
+            }
+        }
+    }
+}
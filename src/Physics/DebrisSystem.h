@@ -0,0 +1,77 @@
+#ifndef DEBRISSYSTEM_H
+#define DEBRISSYSTEM_H
+
+#pragma once
+
+#include <vector>
+
+#include "HashGrid.h"
+#include "Math/Vec2.h"
+#include "ParticleCollider.h"
+
+// Forward declaration
+struct Body;
+class World;
+
+////////////////////////////////////////////////////////////
+// Cosmetic particles: small circles that fall, bounce off
+// the world bodies and disappear when their lifetime runs
+// out. They don't rotate, don't touch each other and don't
+// push the bodies. Particles are bucketed in a hashed grid
+// every step, so each body only visits the particles under
+// it. Fast particles are swept with a ray so they don't
+// tunnel through thin bodies.
+////////////////////////////////////////////////////////////
+class DebrisSystem
+{
+public:
+    // Spawns past this many particles are ignored
+    DebrisSystem(int maxParticles = 100000, float cellSize = 32.0f);
+
+    DebrisSystem(const DebrisSystem&) = delete;
+    DebrisSystem& operator=(const DebrisSystem&) = delete;
+
+    float restitution = 0.4f;
+    float friction = 0.2f;      // Share of the sliding speed lost on each bounce
+    float gravityScale = 1.0f;
+
+    // Filter of the particles against the world bodies and their narrowphase
+    ParticleCollider collider;
+
+    // Particles, one entry per particle in every array. A removed particle is replaced by the last one
+    std::vector<float> x, y;
+    std::vector<float> vx, vy;
+    std::vector<float> radii;
+    std::vector<float> lifetimes;   // Seconds left
+
+    // Returns false when the system is full
+    bool Spawn(const Vec2& position, const Vec2& velocity, float radius, float lifetime);
+
+    inline int GetParticleCount() const { return static_cast<int>(x.size()); }
+    inline int GetMaxParticles() const { return maxParticles; }
+    inline Vec2 GetPosition(int particle) const { return Vec2(x[particle], y[particle]); }
+    void Clear();
+
+    // Age, move and collide the particles over deltaTime under gravity (pixels / s²)
+    void Step(float deltaTime, const Vec2& gravity, World& world);
+
+private:
+    int maxParticles;
+
+    // Positions at the start of the step, for the sweeps
+    std::vector<float> startX, startY;
+
+    // Hashed grid over the particles where they end the step
+    HashGrid grid;
+
+    // Last body that checked each particle, so a bucket shared by two cells is only visited once
+    std::vector<int> visitStamps;
+
+    std::vector<Body*> bodies;
+
+
+    void RemoveExpired();
+    void Collide(int particle, Body* body);
+};
+
+#endif
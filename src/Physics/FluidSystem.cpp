@@ -0,0 +1,304 @@
+#include "FluidSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "./Body.h"
+#include "./World.h"
+
+FluidSystem::FluidSystem(float smoothingRadius, float particleMass) : h(smoothingRadius), mass(particleMass) {
+    const float pi = 3.14159265f;
+    poly6Scale = 4.0f / (pi * std::pow(h, 8.0f));
+    spikyGradientScale = -30.0f / (pi * std::pow(h, 5.0f));
+    tensileReference = Poly6((0.2f * h) * (0.2f * h));
+
+    // Rest density of particles on a square lattice at rest spacing, so blocks start at rest
+    const float spacing = GetParticleSpacing();
+    restDensity = 0.0f;
+    for (int i = -2; i <= 2; i++)
+        for (int j = -2; j <= 2; j++)
+            restDensity += mass * Poly6((i * i + j * j) * spacing * spacing);
+
+    grid.cellSize = h;
+}
+
+int FluidSystem::AddParticle(const Vec2 &position, const Vec2 &velocity) {
+    x.push_back(position.x);
+    y.push_back(position.y);
+    vx.push_back(velocity.x);
+    vy.push_back(velocity.y);
+    return GetParticleCount() - 1;
+}
+
+int FluidSystem::AddBlock(const AABB &box) {
+    const float spacing = GetParticleSpacing();
+    int count = 0;
+    for (float py = box.min.y + 0.5f * spacing; py <= box.max.y; py += spacing) {
+        for (float px = box.min.x + 0.5f * spacing; px <= box.max.x; px += spacing) {
+            AddParticle(Vec2(px, py));
+            count++;
+        }
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 2D poly6 kernel, W(r) = 4 / (π h⁸) (h² - r²)³ for r < h
+///////////////////////////////////////////////////////////////////////////////
+float FluidSystem::Poly6(float distanceSquared) const {
+    if (distanceSquared >= h * h) return 0.0f;
+    const float d = h * h - distanceSquared;
+    return poly6Scale * d * d * d;
+}
+
+void FluidSystem::ParallelFor(int count, const std::function<void(int, int)> &function) {
+    workers.ParallelFor(count, std::min(threadCount, count / 256), function);
+}
+
+void FluidSystem::FindNeighbors() {
+    const int count = GetParticleCount();
+    neighbors.resize(count * MAX_NEIGHBORS);
+    neighborCounts.resize(count);
+
+    ParallelFor(count, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            const int cellX = grid.GetCell(predictedX[i]);
+            const int cellY = grid.GetCell(predictedY[i]);
+
+            // The 3x3 cells around the particle, a bucket shared by two of them is visited once
+            int buckets[9];
+            int bucketCount = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    const int bucket = grid.GetBucket(cellX + dx, cellY + dy);
+                    if (std::find(buckets, buckets + bucketCount, bucket) == buckets + bucketCount)
+                        buckets[bucketCount++] = bucket;
+                }
+            }
+
+            int* list = neighbors.data() + i * MAX_NEIGHBORS;
+            int found = 0;
+            for (int b = 0; b < bucketCount && found < MAX_NEIGHBORS; b++) {
+                for (int c = grid.GetBucketStart(buckets[b]); c < grid.GetBucketStart(buckets[b] + 1); c++) {
+                    const int j = grid.GetPoint(c);
+                    if (j == i) continue;
+                    const float dx = predictedX[j] - predictedX[i];
+                    const float dy = predictedY[j] - predictedY[i];
+                    if (dx * dx + dy * dy >= h * h) continue;
+
+                    list[found++] = j;
+                    if (found == MAX_NEIGHBORS) break;
+                }
+            }
+            neighborCounts[i] = found;
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// One projection of the density constraints Ci = ρi / ρ0 - 1:
+//   λi = -Ci / (Σk |∇k Ci|² + ε)
+//   Δpi = m / ρ0 Σj (λi + λj + s_corr) ∇W(pi - pj)
+// Every particle reads the positions of the last pass only, so both
+// loops run in parallel and the moves are applied once they are done.
+///////////////////////////////////////////////////////////////////////////////
+void FluidSystem::SolveDensities() {
+    const int count = GetParticleCount();
+    const float massOverDensity = mass / restDensity;
+
+    ParallelFor(count, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            const int* list = neighbors.data() + i * MAX_NEIGHBORS;
+            float density = mass * Poly6(0.0f);
+            float gradientX = 0.0f, gradientY = 0.0f;
+            float sumGradientSquared = 0.0f;
+
+            for (int n = 0; n < neighborCounts[i]; n++) {
+                const int j = list[n];
+                const float dx = predictedX[i] - predictedX[j];
+                const float dy = predictedY[i] - predictedY[j];
+                const float distanceSquared = dx * dx + dy * dy;
+                density += mass * Poly6(distanceSquared);
+
+                const float distance = std::sqrt(distanceSquared);
+                if (distance <= 0.0f || distance >= h) continue;
+                const float scale = massOverDensity * spikyGradientScale * (h - distance) * (h - distance) / distance;
+                gradientX += scale * dx;
+                gradientY += scale * dy;
+                sumGradientSquared += scale * scale * distanceSquared;
+            }
+
+            // Only compression is pushed back, pulling sparse particles in would clump the free surface
+            sumGradientSquared += gradientX * gradientX + gradientY * gradientY;
+            const float constraint = std::max(density / restDensity - 1.0f, 0.0f);
+            lambdas[i] = -constraint / (sumGradientSquared + relaxation);
+        }
+    });
+
+    ParallelFor(count, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            const int* list = neighbors.data() + i * MAX_NEIGHBORS;
+            float moveX = 0.0f, moveY = 0.0f;
+
+            for (int n = 0; n < neighborCounts[i]; n++) {
+                const int j = list[n];
+                const float dx = predictedX[i] - predictedX[j];
+                const float dy = predictedY[i] - predictedY[j];
+                const float distanceSquared = dx * dx + dy * dy;
+                const float distance = std::sqrt(distanceSquared);
+                if (distance <= 0.0f || distance >= h) continue;
+
+                const float ratio = Poly6(distanceSquared) / tensileReference;
+                const float tensile = -tensileStrength * ratio * ratio * ratio * ratio;
+                const float scale = (lambdas[i] + lambdas[j] + tensile) * spikyGradientScale * (h - distance) * (h - distance) / distance;
+                moveX += scale * dx;
+                moveY += scale * dy;
+            }
+
+            deltaX[i] = moveX * massOverDensity;
+            deltaY[i] = moveY * massOverDensity;
+        }
+    });
+
+    for (int i = 0; i < count; i++) {
+        predictedX[i] += deltaX[i];
+        predictedY[i] += deltaY[i];
+    }
+}
+
+// Bodies don't move during the substep, so they are looked up once around the predicted
+// positions. The density passes move a particle less than the smoothing radius, which
+// is the room left around the fluid for them
+void FluidSystem::FindBodies(World &world) {
+    const int count = GetParticleCount();
+    AABB bounds(Vec2(predictedX[0], predictedY[0]), Vec2(predictedX[0], predictedY[0]));
+    for (int i = 0; i < count; i++) {
+        bounds.min = Vec2(std::min(bounds.min.x, predictedX[i]), std::min(bounds.min.y, predictedY[i]));
+        bounds.max = Vec2(std::max(bounds.max.x, predictedX[i]), std::max(bounds.max.y, predictedY[i]));
+    }
+
+    bodies.clear();
+    collider.QueryBodies(world, AABB(bounds.min - Vec2(h, h), bounds.max + Vec2(h, h)), bodies);
+
+    const float radius = 0.5f * GetParticleSpacing();
+    bodyBoxes.resize(bodies.size());
+    for (int b = 0; b < static_cast<int>(bodies.size()); b++) {
+        const AABB box = bodies[b]->shape->GetAABB();
+        bodyBoxes[b] = AABB(box.min - Vec2(radius, radius), box.max + Vec2(radius, radius));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The grid is rebuilt over the positions of the last density pass and every
+// body visits the particles in the cells under its box. A particle inside a
+// body leaves along the deepest contact, the push is kept so the body can
+// take the opposite momentum at the end of the substep.
+///////////////////////////////////////////////////////////////////////////////
+void FluidSystem::SolveCollisions() {
+    if (bodies.empty()) return;
+
+    const int count = GetParticleCount();
+    const float radius = 0.5f * GetParticleSpacing();
+    grid.Build(predictedX.data(), predictedY.data(), count);
+    visitStamps.assign(count, -1);
+
+    for (int b = 0; b < static_cast<int>(bodies.size()); b++) {
+        const AABB& box = bodyBoxes[b];
+        const int minCellX = grid.GetCell(box.min.x);
+        const int minCellY = grid.GetCell(box.min.y);
+        const int maxCellX = grid.GetCell(box.max.x);
+        const int maxCellY = grid.GetCell(box.max.y);
+
+        for (int cellY = minCellY; cellY <= maxCellY; cellY++) {
+            for (int cellX = minCellX; cellX <= maxCellX; cellX++) {
+                const int bucket = grid.GetBucket(cellX, cellY);
+                for (int c = grid.GetBucketStart(bucket); c < grid.GetBucketStart(bucket + 1); c++) {
+                    const int i = grid.GetPoint(c);
+                    if (visitStamps[i] == b) continue;
+                    visitStamps[i] = b;
+
+                    const Vec2 position(predictedX[i], predictedY[i]);
+                    if (!box.Contains(position)) continue;
+
+                    Contact contact;
+                    if (!collider.GetDeepestContact(bodies[b], position, radius, contact)) continue;
+
+                    const Vec2 push = contact.normal * contact.depth;
+                    predictedX[i] += push.x;
+                    predictedY[i] += push.y;
+                    pushes.push_back({bodies[b], i, push});
+                }
+            }
+        }
+    }
+}
+
+void FluidSystem::Step(float deltaTime, const Vec2 &gravity, World &world) {
+    if (GetParticleCount() == 0 || deltaTime <= 0.0f || substeps <= 0) return;
+
+    for (int substep = 0; substep < substeps; substep++)
+        Substep(deltaTime / substeps, gravity, world);
+}
+
+void FluidSystem::Substep(float deltaTime, const Vec2 &gravity, World &world) {
+    const int count = GetParticleCount();
+
+    predictedX.resize(count);
+    predictedY.resize(count);
+    lambdas.resize(count);
+    deltaX.resize(count);
+    deltaY.resize(count);
+    pushes.clear();
+
+    for (int i = 0; i < count; i++) {
+        vx[i] += gravity.x * deltaTime;
+        vy[i] += gravity.y * deltaTime;
+        predictedX[i] = x[i] + vx[i] * deltaTime;
+        predictedY[i] = y[i] + vy[i] * deltaTime;
+    }
+
+    grid.Build(predictedX.data(), predictedY.data(), count);
+    FindNeighbors();
+    FindBodies(world);
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        SolveDensities();
+        SolveCollisions();
+    }
+
+    // Velocities from the corrected positions, then XSPH viscosity
+    ParallelFor(count, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            vx[i] = (predictedX[i] - x[i]) / deltaTime;
+            vy[i] = (predictedY[i] - y[i]) / deltaTime;
+        }
+    });
+    ParallelFor(count, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            const int* list = neighbors.data() + i * MAX_NEIGHBORS;
+            float blendX = 0.0f, blendY = 0.0f;
+            for (int n = 0; n < neighborCounts[i]; n++) {
+                const int j = list[n];
+                const float dx = predictedX[i] - predictedX[j];
+                const float dy = predictedY[i] - predictedY[j];
+                const float weight = Poly6(dx * dx + dy * dy) * mass / restDensity;
+                blendX += (vx[j] - vx[i]) * weight;
+                blendY += (vy[j] - vy[i]) * weight;
+            }
+            deltaX[i] = blendX * viscosity;
+            deltaY[i] = blendY * viscosity;
+        }
+    });
+    for (int i = 0; i < count; i++) {
+        vx[i] += deltaX[i];
+        vy[i] += deltaY[i];
+        x[i] = predictedX[i];
+        y[i] = predictedY[i];
+    }
+
+    // Momentum the bodies gave the particles they pushed out, each body takes back its own share
+    for (const Push& push: pushes) {
+        const Vec2 impulse = push.displacement * (-mass / deltaTime);
+        push.body->ApplyImpulseAtPoint(impulse, Vec2(x[push.particle], y[push.particle]) - push.body->position);
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef FLUIDSYSTEM_H
+#define FLUIDSYSTEM_H
+
+#pragma once
+
+#include <vector>
+
+#include "AABB.h"
+#include "HashGrid.h"
+#include "Math/Vec2.h"
+#include "ParticleCollider.h"
+#include "WorkerPool.h"
+
+// Forward declaration
+struct Body;
+class World;
+
+////////////////////////////////////////////////////////////
+// Position based fluid (Macklin and Müller, "Position Based
+// Fluids"). Particles hold the rest density by moving along
+// the density gradient, neighbours are found through a hashed
+// grid of cells one smoothing radius wide. Particles are
+// pushed out of the world bodies and push them back with the
+// same momentum. The density and pressure passes are split
+// over threadCount threads.
+////////////////////////////////////////////////////////////
+class FluidSystem
+{
+public:
+    // Particles further apart than the smoothing radius don't interact. They rest half of it apart
+    FluidSystem(float smoothingRadius = 16.0f, float particleMass = 1.0f);
+
+    FluidSystem(const FluidSystem&) = delete;
+    FluidSystem& operator=(const FluidSystem&) = delete;
+
+    // Substeps per world step, particles moving more than about half the smoothing radius per substep gain energy
+    int substeps = 2;
+
+    // Density projection passes per substep
+    int iterations = 4;
+
+    // Threads of the density, pressure and velocity passes
+    int threadCount = 1;
+
+    // Relaxation of the density constraint, keeps the pressure finite in sparse regions
+    float relaxation = 0.0001f;
+
+    // XSPH viscosity, share of the neighbours' relative velocity a particle takes each step
+    float viscosity = 0.01f;
+
+    // Artificial pressure, k (Δq = 0.2 h, n = 4) of the paper. Keeps particles from clumping at the surface
+    float tensileStrength = 0.1f;
+
+    // Filter of the particles against the world bodies and their narrowphase
+    ParticleCollider collider;
+
+    // Particles, one entry per particle in every array
+    std::vector<float> x, y;
+    std::vector<float> vx, vy;
+
+    int AddParticle(const Vec2& position, const Vec2& velocity = Vec2());
+
+    // Fill the box with particles at rest spacing. Returns how many were added
+    int AddBlock(const AABB& box);
+
+    inline int GetParticleCount() const { return static_cast<int>(x.size()); }
+    inline Vec2 GetPosition(int particle) const { return Vec2(x[particle], y[particle]); }
+    inline float GetSmoothingRadius() const { return h; }
+    inline float GetParticleSpacing() const { return 0.5f * h; }
+    inline float GetParticleMass() const { return mass; }
+    inline float GetRestDensity() const { return restDensity; }
+
+    // Advance the particles by deltaTime under gravity (pixels / s²), colliding with the bodies of the world
+    void Step(float deltaTime, const Vec2& gravity, World& world);
+
+private:
+    static constexpr int MAX_NEIGHBORS = 64;
+
+    float h;
+    float mass;
+    float restDensity;
+
+    // Kernel constants for h, poly6 for the density and spiky for its gradient
+    float poly6Scale;
+    float spikyGradientScale;
+    float tensileReference;
+
+    // Predicted positions and per particle values of the solver
+    std::vector<float> predictedX, predictedY;
+    std::vector<float> lambdas;
+    std::vector<float> deltaX, deltaY;
+
+    // Displacement a body gave a particle it pushed out, the body takes the opposite momentum at the end of the substep
+    struct Push {
+        Body* body = nullptr;
+        int particle = 0;
+        Vec2 displacement{};
+    };
+    std::vector<Push> pushes;
+
+    // Neighbours, particle i owns neighbors[i * MAX_NEIGHBORS .. + neighborCounts[i]]
+    std::vector<int> neighbors;
+    std::vector<int> neighborCounts;
+
+    // Hashed grid over the predicted positions, cells one smoothing radius wide
+    HashGrid grid;
+
+    // Bodies around the fluid and their boxes grown by the particle radius, found once per substep
+    std::vector<Body*> bodies;
+    std::vector<AABB> bodyBoxes;
+
+    // Last body that checked each particle in a collision pass, so a bucket shared by two cells is only visited once
+    std::vector<int> visitStamps;
+
+
+    float Poly6(float distanceSquared) const;
+
+    // Threads of the parallel passes, kept across substeps
+    WorkerPool workers;
+
+    // Splits [0, count) over the threads, none of them gets less than a few hundred particles
+    void ParallelFor(int count, const std::function<void(int, int)>& function);
+
+    void FindNeighbors();
+    void SolveDensities();
+    void FindBodies(World& world);
+    void SolveCollisions();
+    void Substep(float deltaTime, const Vec2& gravity, World& world);
+};
+
+#endif
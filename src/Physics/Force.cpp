@@ -2,6 +2,10 @@
 
 #include "./Constants.h"
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <utility>
 
 Vec2 Force::GenerateDragForce(const Body& particle, float dragCoefficient) {
     Vec2 dragForce = Vec2();
@@ -57,6 +61,271 @@ Vec2 Force::GenerateGravitationalForce(const Body& a, const Body& b, float G, fl
     return attractionForce;
 }
 
+namespace {
+    // Attraction of a body at "position" towards a mass at "target", clamped like GenerateGravitationalForce
+    Vec2 Attraction(const Vec2& position, float mass, const Vec2& target, float targetMass, float G, float minDistance, float maxDistance) {
+        const Vec2 d = target - position;
+        const float distanceSquared = std::clamp(d.MagnitudeSquared(), minDistance, maxDistance);
+        return d.UnitVector() * (G * mass * targetMass / distanceSquared);
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Barnes-Hut quadtree over the body positions. Leaves keep
+    // a list of their bodies (several only at the depth limit,
+    // when bodies share a position), every node the total mass
+    // and center of mass of what it holds.
+    ////////////////////////////////////////////////////////////
+    class GravityTree {
+    public:
+        static constexpr int MAX_DEPTH = 24;
+
+        struct Node {
+            Vec2 center{};              // Center of the square cell
+            float halfSize = 0.0f;
+            Vec2 centerOfMass{};
+            float mass = 0.0f;
+            int firstChild = -1;        // Four consecutive children, -1 for leaves
+            int firstBody = -1;         // Bodies of a leaf, linked through "nextBody"
+            int depth = 0;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<int> nextBody;
+
+        void Build(const std::vector<Body*>& bodies) {
+            nodes.clear();
+            nextBody.assign(bodies.size(), -1);
+            if (bodies.empty()) return;
+
+            Vec2 min = bodies[0]->position;
+            Vec2 max = bodies[0]->position;
+            for (const Body* body: bodies) {
+                min = Vec2(std::min(min.x, body->position.x), std::min(min.y, body->position.y));
+                max = Vec2(std::max(max.x, body->position.x), std::max(max.y, body->position.y));
+            }
+
+            Node root;
+            root.center = (min + max) * 0.5f;
+            root.halfSize = std::max(max.x - min.x, max.y - min.y) * 0.5f + 1.0f;
+            nodes.push_back(root);
+
+            for (int i = 0; i < bodies.size(); i++)
+                Insert(bodies, i);
+
+            // Children always come after their parent, so a backward pass sums the leaves up
+            for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; i--) {
+                Node& node = nodes[i];
+                Vec2 weightedPosition{};
+                if (node.firstChild < 0) {
+                    for (int b = node.firstBody; b >= 0; b = nextBody[b]) {
+                        node.mass += bodies[b]->mass;
+                        weightedPosition += bodies[b]->position * bodies[b]->mass;
+                    }
+                } else {
+                    for (int c = node.firstChild; c < node.firstChild + 4; c++) {
+                        node.mass += nodes[c].mass;
+                        weightedPosition += nodes[c].centerOfMass * nodes[c].mass;
+                    }
+                }
+                node.centerOfMass = node.mass > 0.0f ? weightedPosition / node.mass : node.center;
+            }
+        }
+
+        int GetQuadrant(const Node& node, const Vec2& position) const {
+            return (position.x >= node.center.x ? 1 : 0) + (position.y >= node.center.y ? 2 : 0);
+        }
+
+    private:
+        void Insert(const std::vector<Body*>& bodies, int index) {
+            const Vec2& position = bodies[index]->position;
+            int nodeIndex = 0;
+            while (true) {
+                if (nodes[nodeIndex].firstChild >= 0) {
+                    nodeIndex = nodes[nodeIndex].firstChild + GetQuadrant(nodes[nodeIndex], position);
+                    continue;
+                }
+
+                // Empty leaf, or too deep to split any further
+                if (nodes[nodeIndex].firstBody < 0 || nodes[nodeIndex].depth >= MAX_DEPTH) {
+                    nextBody[index] = nodes[nodeIndex].firstBody;
+                    nodes[nodeIndex].firstBody = index;
+                    return;
+                }
+
+                // Split the leaf and move its body down, then keep descending
+                const int firstChild = static_cast<int>(nodes.size());
+                for (int quadrant = 0; quadrant < 4; quadrant++) {
+                    Node child;
+                    child.halfSize = nodes[nodeIndex].halfSize * 0.5f;
+                    child.center = nodes[nodeIndex].center + Vec2(quadrant & 1 ? child.halfSize : -child.halfSize, quadrant & 2 ? child.halfSize : -child.halfSize);
+                    child.depth = nodes[nodeIndex].depth + 1;
+                    nodes.push_back(child);
+                }
+
+                Node& node = nodes[nodeIndex];
+                const int resident = node.firstBody;
+                node.firstBody = -1;
+                node.firstChild = firstChild;
+                Node& child = nodes[firstChild + GetQuadrant(node, bodies[resident]->position)];
+                nextBody[resident] = -1;
+                child.firstBody = resident;
+            }
+        }
+    };
+}
+
+void Force::ApplyGravitationalForces(const std::vector<Body*>& bodies, float G, float minDistance, float maxDistance, float theta) {
+    GravityTree tree;
+    tree.Build(bodies);
+    if (tree.nodes.empty()) return;
+
+    const float thetaSquared = theta * theta;
+    std::vector<int> stack;
+    for (int i = 0; i < bodies.size(); i++) {
+        Body* body = bodies[i];
+        Vec2 force{};
+
+        stack.clear();
+        stack.push_back(0);
+        while (!stack.empty()) {
+            const GravityTree::Node& node = tree.nodes[stack.back()];
+            stack.pop_back();
+            if (node.mass <= 0.0f) continue;
+
+            if (node.firstChild < 0) {
+                for (int b = node.firstBody; b >= 0; b = tree.nextBody[b]) {
+                    if (b != i)
+                        force += Attraction(body->position, body->mass, bodies[b]->position, bodies[b]->mass, G, minDistance, maxDistance);
+                }
+                continue;
+            }
+
+            // Far enough (cell size / distance below theta) and not holding the body itself: one mass for the whole cell
+            const Vec2 offset = body->position - node.center;
+            const bool isInside = std::abs(offset.x) <= node.halfSize && std::abs(offset.y) <= node.halfSize;
+            const float size = 2.0f * node.halfSize;
+            if (!isInside && size * size < thetaSquared * (node.centerOfMass - body->position).MagnitudeSquared()) {
+                force += Attraction(body->position, body->mass, node.centerOfMass, node.mass, G, minDistance, maxDistance);
+                continue;
+            }
+
+            for (int c = node.firstChild; c < node.firstChild + 4; c++)
+                stack.push_back(c);
+        }
+
+        body->AddForce(force);
+    }
+}
+
+namespace {
+    ////////////////////////////////////////////////////////////
+    // All-pairs gravity between two tiles of packed bodies.
+    // The lane loop has no branches so it compiles to SIMD,
+    // each lane keeps its own sum for body i since the float
+    // adds can't be reordered into a single one. A symmetric
+    // tile also pushes the opposite force onto the j bodies.
+    ////////////////////////////////////////////////////////////
+    template<bool IS_SYMMETRIC>
+    void AccumulateGravityTile(const float* x, const float* y, const float* mass, int first, int second, float G, float minDistance, float maxDistance,
+                               float* forceX, float* forceY) {
+        constexpr int LANES = Force::GRAVITY_LANES;
+        for (int i = first; i < first + Force::GRAVITY_TILE_SIZE; i++) {
+            const float xi = x[i];
+            const float yi = y[i];
+            const float gmi = G * mass[i];
+            float sumX[LANES] = {};
+            float sumY[LANES] = {};
+
+            for (int j0 = second; j0 < second + Force::GRAVITY_TILE_SIZE; j0 += LANES) {
+                for (int lane = 0; lane < LANES; lane++) {
+                    const int j = j0 + lane;
+                    const float dx = x[j] - xi;
+                    const float dy = y[j] - yi;
+                    const float distanceSquared = dx * dx + dy * dy;
+
+                    // Coincident bodies (i itself, massless padding at the origin) give no force. The terms are kept
+                    // finite and the mass of a coincident body is selected away rather than branched on, so the loop
+                    // compiles to SIMD (the select has to be on a load, GCC sinks a masked result back into a branch)
+                    const float inverseDistance = 1.0f / std::sqrt(distanceSquared + std::numeric_limits<float>::min());
+                    const float clampedSquared = std::max(std::min(std::max(distanceSquared, minDistance), maxDistance),
+                                                          std::numeric_limits<float>::min());
+                    const float massJ = distanceSquared > 0.0f ? mass[j] : 0.0f;
+                    const float scale = gmi * massJ / clampedSquared * inverseDistance;
+
+                    sumX[lane] += scale * dx;
+                    sumY[lane] += scale * dy;
+                    if (IS_SYMMETRIC) {
+                        forceX[j] -= scale * dx;
+                        forceY[j] -= scale * dy;
+                    }
+                }
+            }
+
+            for (int lane = 0; lane < LANES; lane++) {
+                forceX[i] += sumX[lane];
+                forceY[i] += sumY[lane];
+            }
+        }
+    }
+}
+
+void Force::GenerateGravitationalForces(const float* x, const float* y, const float* mass, int count, float G, float minDistance, float maxDistance,
+                                        float* outForceX, float* outForceY, int threadCount) {
+    if (count <= 0) return;
+
+    // Copies padded to whole tiles, the massless padding bodies add nothing
+    const int tileCount = (count + GRAVITY_TILE_SIZE - 1) / GRAVITY_TILE_SIZE;
+    const int paddedCount = tileCount * GRAVITY_TILE_SIZE;
+    std::vector<float> packedX(x, x + count), packedY(y, y + count), packedMass(mass, mass + count);
+    packedX.resize(paddedCount, 0.0f);
+    packedY.resize(paddedCount, 0.0f);
+    packedMass.resize(paddedCount, 0.0f);
+
+    // Upper triangle of the tile matrix, a tile against itself can't write both sides of a pair
+    std::vector<std::pair<int, int>> tiles;
+    tiles.reserve(tileCount * (tileCount + 1) / 2);
+    for (int i = 0; i < tileCount; i++)
+        for (int j = i; j < tileCount; j++)
+            tiles.emplace_back(i * GRAVITY_TILE_SIZE, j * GRAVITY_TILE_SIZE);
+
+    // Every thread sums into its own force arrays, added together at the end
+    threadCount = std::max(1, std::min(threadCount, static_cast<int>(tiles.size())));
+    std::vector<std::vector<float>> forcesX(threadCount, std::vector<float>(paddedCount, 0.0f));
+    std::vector<std::vector<float>> forcesY(threadCount, std::vector<float>(paddedCount, 0.0f));
+
+    auto accumulateTiles = [&](int thread) {
+        const int tileFirst = static_cast<int>(tiles.size()) * thread / threadCount;
+        const int tileLast = static_cast<int>(tiles.size()) * (thread + 1) / threadCount;
+        float* forceX = forcesX[thread].data();
+        float* forceY = forcesY[thread].data();
+        for (int t = tileFirst; t < tileLast; t++) {
+            if (tiles[t].first == tiles[t].second)
+                AccumulateGravityTile<false>(packedX.data(), packedY.data(), packedMass.data(), tiles[t].first, tiles[t].second, G, minDistance, maxDistance, forceX, forceY);
+            else
+                AccumulateGravityTile<true>(packedX.data(), packedY.data(), packedMass.data(), tiles[t].first, tiles[t].second, G, minDistance, maxDistance, forceX, forceY);
+        }
+    };
+
+    // Contiguous chunks of tiles per thread, the calling thread takes the last one
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (int i = 0; i < threadCount - 1; i++)
+        workers.emplace_back(accumulateTiles, i);
+    accumulateTiles(threadCount - 1);
+
+    for (std::thread &worker : workers)
+        worker.join();
+
+    for (int i = 0; i < count; i++) {
+        outForceX[i] = 0.0f;
+        outForceY[i] = 0.0f;
+        for (int thread = 0; thread < threadCount; thread++) {
+            outForceX[i] += forcesX[thread][i];
+            outForceY[i] += forcesY[thread][i];
+        }
+    }
+}
+
 Vec2 Force::GenerateSpringForce(const Body &a, Vec2 anchor, float restLength, float springConstant) {
     // Calculate the distance between the particle and the anchor
     Vec2 d = (a.position - anchor);
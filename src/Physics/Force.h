@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "Math/Vec2.h"
 #include "./Body.h"
 
@@ -10,6 +12,21 @@ struct Force {
     static Vec2 GenerateDragForce(const Body& particle, float dragCoefficient);
     static Vec2 GenerateFrictionForce(const Body& particle, float frictionCoefficient);
     static Vec2 GenerateGravitationalForce(const Body& a, const Body& b, float G, float minDistance, float maxDistance);
+
+    // Mutual attraction of all the bodies (same clamp as GenerateGravitationalForce), added to each body in O(n log n).
+    // Cells of a Barnes-Hut quadtree seen under an angle below theta act as a single mass, zero gives the exact sum.
+    static void ApplyGravitationalForces(const std::vector<Body*>& bodies, float G, float minDistance, float maxDistance, float theta = 0.5f);
+
+    // Bodies per tile and lanes per inner loop of the all-pairs kernel, 8 floats fill an AVX2 register
+    static constexpr int GRAVITY_TILE_SIZE = 64;
+    static constexpr int GRAVITY_LANES = 8;
+
+    // Exact mutual attraction of count bodies packed as arrays (same clamp as GenerateGravitationalForce), written to
+    // outForceX/outForceY. Each pair is evaluated once, tile against tile, with the tiles split over threadCount threads.
+    // Faster than the tree up to a couple thousand bodies
+    static void GenerateGravitationalForces(const float* x, const float* y, const float* mass, int count, float G, float minDistance, float maxDistance,
+                                            float* outForceX, float* outForceY, int threadCount = 1);
+
     static Vec2 GenerateSpringForce(const Body& a, Vec2 anchor, float restLength, float springConstant);
     static Vec2 GenerateSpringForce(const Body& a, const Body& b, float restLength, float springConstant);
 };
@@ -0,0 +1,115 @@
+#include "ForceField.h"
+
+#include "./Body.h"
+#include "./Force.h"
+
+void ForceField::SetRegion(const AABB &box) {
+    region = box;
+    isRegionLimited = true;
+}
+
+void ForceField::ClearRegion() {
+    isRegionLimited = false;
+}
+
+void ForceField::SetCircleRegion(const Vec2 &center, float radius) {
+    if (radius > 0.0f)
+        SetRegion(AABB(center - Vec2(radius, radius), center + Vec2(radius, radius)));
+    else
+        ClearRegion();
+}
+
+namespace {
+    // Strength left at "distance" from the center of a field that fades out at "radius" (zero radius: no fading)
+    float GetFalloff(float distance, float radius) {
+        if (radius <= 0.0f) return 1.0f;
+        return distance < radius ? 1.0f - distance / radius : 0.0f;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// UniformForceField
+///////////////////////////////////////////////////////////////////////////////
+UniformForceField::UniformForceField(const Vec2 &force, float torque) : force(force), torque(torque) {
+}
+
+void UniformForceField::Apply(Body* const* bodies, int count) const {
+    for (int i = 0; i < count; i++) {
+        bodies[i]->AddForce(force);
+        bodies[i]->AddTorque(torque);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// RadialForceField
+///////////////////////////////////////////////////////////////////////////////
+RadialForceField::RadialForceField(const Vec2 &center, float strength, float radius) : strength(strength), center(center), radius(radius) {
+    SetCircleRegion(center, radius);
+}
+
+void RadialForceField::SetCenter(const Vec2 &center) {
+    this->center = center;
+    SetCircleRegion(center, radius);
+}
+
+void RadialForceField::SetRadius(float radius) {
+    this->radius = radius;
+    SetCircleRegion(center, radius);
+}
+
+void RadialForceField::Apply(Body* const* bodies, int count) const {
+    for (int i = 0; i < count; i++) {
+        const Vec2 d = center - bodies[i]->position;
+        const float distance = d.Magnitude();
+        if (distance <= 0.0f) continue;
+
+        bodies[i]->AddForce(d * (strength * GetFalloff(distance, radius) / distance));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DragForceField
+///////////////////////////////////////////////////////////////////////////////
+DragForceField::DragForceField(float dragCoefficient, float frictionCoefficient, float angularDragCoefficient)
+    : dragCoefficient(dragCoefficient), frictionCoefficient(frictionCoefficient), angularDragCoefficient(angularDragCoefficient) {
+}
+
+void DragForceField::Apply(Body* const* bodies, int count) const {
+    for (int i = 0; i < count; i++) {
+        Body* body = bodies[i];
+        if (dragCoefficient != 0.0f)
+            body->AddForce(Force::GenerateDragForce(*body, dragCoefficient));
+        if (frictionCoefficient != 0.0f)
+            body->AddForce(Force::GenerateFrictionForce(*body, frictionCoefficient));
+        body->AddTorque(-angularDragCoefficient * body->angularVelocity);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// VortexForceField
+///////////////////////////////////////////////////////////////////////////////
+VortexForceField::VortexForceField(const Vec2 &center, float strength, float radius) : strength(strength), center(center), radius(radius) {
+    SetCircleRegion(center, radius);
+}
+
+void VortexForceField::SetCenter(const Vec2 &center) {
+    this->center = center;
+    SetCircleRegion(center, radius);
+}
+
+void VortexForceField::SetRadius(float radius) {
+    this->radius = radius;
+    SetCircleRegion(center, radius);
+}
+
+void VortexForceField::Apply(Body* const* bodies, int count) const {
+    for (int i = 0; i < count; i++) {
+        const Vec2 d = bodies[i]->position - center;
+        const float distance = d.Magnitude();
+        if (distance <= 0.0f) continue;
+
+        // Perpendicular to the offset, a quarter turn from +x towards +y
+        const Vec2 tangent(-d.y, d.x);
+        bodies[i]->AddForce(tangent * (strength * GetFalloff(distance, radius) / distance));
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef FORCEFIELD_H
+#define FORCEFIELD_H
+
+#pragma once
+
+#include "./AABB.h"
+#include "./Math/Vec2.h"
+
+// Forward declaration
+struct Body;
+
+// Force applied by the world to the dynamic bodies every step, before integrating them
+class ForceField
+{
+public:
+    virtual ~ForceField() = default;
+
+    // Limit the field to the bodies whose center is inside the box, found through the broadphase
+    void SetRegion(const AABB& box);
+    void ClearRegion();
+    inline bool IsRegionLimited() const { return isRegionLimited; }
+    inline const AABB& GetRegion() const { return region; }
+
+    // Add the force of the field to a batch of bodies, all of them already inside the region
+    virtual void Apply(Body* const* bodies, int count) const = 0;
+
+protected:
+    // Region of a field fading out at radius around center, none for a zero radius
+    void SetCircleRegion(const Vec2& center, float radius);
+
+private:
+    AABB region{};
+    bool isRegionLimited = false;
+};
+
+// Same force and torque on every body, like wind
+class UniformForceField : public ForceField
+{
+public:
+    Vec2 force{};
+    float torque = 0.0f;
+
+    UniformForceField() = default;
+    UniformForceField(const Vec2& force, float torque = 0.0f);
+
+    void Apply(Body* const* bodies, int count) const override;
+};
+
+// Pull towards the center (push away for a negative strength), fading linearly to zero at the radius.
+// A zero radius gives the full strength everywhere, otherwise the region is set to the bounds of the circle
+class RadialForceField : public ForceField
+{
+public:
+    float strength = 0.0f;
+
+    RadialForceField() = default;
+    RadialForceField(const Vec2& center, float strength, float radius = 0.0f);
+
+    // Moving or resizing the field moves its region along
+    void SetCenter(const Vec2& center);
+    void SetRadius(float radius);
+    inline const Vec2& GetCenter() const { return center; }
+    inline float GetRadius() const { return radius; }
+
+    void Apply(Body* const* bodies, int count) const override;
+
+private:
+    Vec2 center{};
+    float radius = 0.0f;
+};
+
+// Quadratic drag against the velocity (Force::GenerateDragForce), a constant friction
+// (Force::GenerateFrictionForce) and a torque against the angular velocity
+class DragForceField : public ForceField
+{
+public:
+    float dragCoefficient = 0.0f;
+    float frictionCoefficient = 0.0f;
+    float angularDragCoefficient = 0.0f;
+
+    DragForceField() = default;
+    DragForceField(float dragCoefficient, float frictionCoefficient = 0.0f, float angularDragCoefficient = 0.0f);
+
+    void Apply(Body* const* bodies, int count) const override;
+};
+
+// Push around the center, from +x towards +y for a positive strength, fading linearly to zero at the radius.
+// A zero radius gives the full strength everywhere, otherwise the region is set to the bounds of the circle
+class VortexForceField : public ForceField
+{
+public:
+    float strength = 0.0f;
+
+    VortexForceField() = default;
+    VortexForceField(const Vec2& center, float strength, float radius = 0.0f);
+
+    // Moving or resizing the field moves its region along
+    void SetCenter(const Vec2& center);
+    void SetRadius(float radius);
+    inline const Vec2& GetCenter() const { return center; }
+    inline float GetRadius() const { return radius; }
+
+    void Apply(Body* const* bodies, int count) const override;
+
+private:
+    Vec2 center{};
+    float radius = 0.0f;
+};
+
+#endif
@@ -0,0 +1,384 @@
+#include "GJK.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "Shape.h"
+
+namespace {
+    constexpr int GJK_MAX_ITERATIONS = 20;
+    constexpr float GJK_TOLERANCE = 0.0001f;
+    constexpr int EPA_MAX_ITERATIONS = 32;
+    constexpr float EPA_TOLERANCE = 0.001f;
+
+    // Point of the Minkowski difference B - A, with the support points that generated it
+    struct SimplexVertex {
+        Vec2 wA{};          // Support point of "a" along -direction
+        Vec2 wB{};          // Support point of "b" along direction
+        Vec2 w{};           // wB - wA
+        Vec2 direction{};   // Search direction used for this vertex
+        float a = 0.0f;     // Barycentric coordinate of the closest point
+    };
+
+    SimplexVertex MakeVertex(const Shape& a, const Shape& b, const Vec2& direction) {
+        SimplexVertex vertex;
+        vertex.direction = direction;
+        vertex.wA = a.GetSupportPoint(direction * -1.0f);
+        vertex.wB = b.GetSupportPoint(direction);
+        vertex.w = vertex.wB - vertex.wA;
+        return vertex;
+    }
+
+    struct Simplex {
+        SimplexVertex v[3];
+        int count = 0;
+
+        ////////////////////////////////////////////////////////////
+        // Closest point of a segment to the origin, reducing the
+        // simplex to the vertex region when it is outside the edge
+        ////////////////////////////////////////////////////////////
+        void Solve2() {
+            const Vec2 w1 = v[0].w;
+            const Vec2 w2 = v[1].w;
+            const Vec2 e12 = w2 - w1;
+
+            // w1 region
+            const float d12_2 = -w1.Dot(e12);
+            if (d12_2 <= 0.0f) {
+                v[0].a = 1.0f;
+                count = 1;
+                return;
+            }
+
+            // w2 region
+            const float d12_1 = w2.Dot(e12);
+            if (d12_1 <= 0.0f) {
+                v[1].a = 1.0f;
+                count = 1;
+                v[0] = v[1];
+                return;
+            }
+
+            // Must be in e12 region
+            const float inv = 1.0f / (d12_1 + d12_2);
+            v[0].a = d12_1 * inv;
+            v[1].a = d12_2 * inv;
+            count = 2;
+        }
+
+        ////////////////////////////////////////////////////////////
+        // Closest point of a triangle to the origin, testing the
+        // vertex, edge and interior Voronoi regions
+        ////////////////////////////////////////////////////////////
+        void Solve3() {
+            const Vec2 w1 = v[0].w;
+            const Vec2 w2 = v[1].w;
+            const Vec2 w3 = v[2].w;
+
+            const Vec2 e12 = w2 - w1;
+            const float d12_1 = w2.Dot(e12);
+            const float d12_2 = -w1.Dot(e12);
+
+            const Vec2 e13 = w3 - w1;
+            const float d13_1 = w3.Dot(e13);
+            const float d13_2 = -w1.Dot(e13);
+
+            const Vec2 e23 = w3 - w2;
+            const float d23_1 = w3.Dot(e23);
+            const float d23_2 = -w2.Dot(e23);
+
+            // Triangle123
+            const float n123 = e12.Cross(e13);
+            const float d123_1 = n123 * w2.Cross(w3);
+            const float d123_2 = n123 * w3.Cross(w1);
+            const float d123_3 = n123 * w1.Cross(w2);
+
+            // w1 region
+            if (d12_2 <= 0.0f && d13_2 <= 0.0f) {
+                v[0].a = 1.0f;
+                count = 1;
+                return;
+            }
+
+            // e12
+            if (d12_1 > 0.0f && d12_2 > 0.0f && d123_3 <= 0.0f) {
+                const float inv = 1.0f / (d12_1 + d12_2);
+                v[0].a = d12_1 * inv;
+                v[1].a = d12_2 * inv;
+                count = 2;
+                return;
+            }
+
+            // e13
+            if (d13_1 > 0.0f && d13_2 > 0.0f && d123_2 <= 0.0f) {
+                const float inv = 1.0f / (d13_1 + d13_2);
+                v[0].a = d13_1 * inv;
+                v[2].a = d13_2 * inv;
+                count = 2;
+                v[1] = v[2];
+                return;
+            }
+
+            // w2 region
+            if (d12_1 <= 0.0f && d23_2 <= 0.0f) {
+                v[1].a = 1.0f;
+                count = 1;
+                v[0] = v[1];
+                return;
+            }
+
+            // w3 region
+            if (d13_1 <= 0.0f && d23_1 <= 0.0f) {
+                v[2].a = 1.0f;
+                count = 1;
+                v[0] = v[2];
+                return;
+            }
+
+            // e23
+            if (d23_1 > 0.0f && d23_2 > 0.0f && d123_1 <= 0.0f) {
+                const float inv = 1.0f / (d23_1 + d23_2);
+                v[1].a = d23_1 * inv;
+                v[2].a = d23_2 * inv;
+                count = 2;
+                v[0] = v[2];
+                return;
+            }
+
+            // Must be in triangle123, the origin is inside the simplex
+            const float inv = 1.0f / (d123_1 + d123_2 + d123_3);
+            v[0].a = d123_1 * inv;
+            v[1].a = d123_2 * inv;
+            v[2].a = d123_3 * inv;
+            count = 3;
+        }
+
+        Vec2 GetSearchDirection() const {
+            if (count == 1)
+                return v[0].w * -1.0f;
+
+            // Perpendicular of the edge pointing towards the origin
+            const Vec2 e12 = v[1].w - v[0].w;
+            const float sign = e12.Cross(v[0].w * -1.0f);
+            if (sign > 0.0f)
+                return Vec2(-e12.y, e12.x);
+            return Vec2(e12.y, -e12.x);
+        }
+
+        void GetWitnessPoints(Vec2& pointA, Vec2& pointB) const {
+            pointA = Vec2();
+            pointB = Vec2();
+            for (int i = 0; i < count; i++) {
+                pointA += v[i].wA * v[i].a;
+                pointB += v[i].wB * v[i].a;
+            }
+        }
+
+        bool Contains(const Vec2& w) const {
+            for (int i = 0; i < count; i++) {
+                if (v[i].w == w) return true;
+            }
+            return false;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////
+    // Run GJK on the shape cores, the simplex either encloses the
+    // origin (count 3) or holds the closest feature to it
+    ////////////////////////////////////////////////////////////
+    int RunGJK(const Shape& a, const Shape& b, Simplex& simplex, const SimplexCache* cache) {
+        simplex.count = 0;
+
+        // Warm start re-evaluating the supports along the cached directions
+        if (cache) {
+            for (int i = 0; i < cache->count; i++) {
+                SimplexVertex vertex = MakeVertex(a, b, cache->directions[i]);
+                if (!simplex.Contains(vertex.w))
+                    simplex.v[simplex.count++] = vertex;
+            }
+        }
+        if (simplex.count == 0)
+            simplex.v[simplex.count++] = MakeVertex(a, b, Vec2(1.0f, 0.0f));
+        for (int i = 0; i < simplex.count; i++)
+            simplex.v[i].a = 1.0f / simplex.count;
+
+        int iterations = 0;
+        while (iterations < GJK_MAX_ITERATIONS) {
+            switch (simplex.count) {
+                case 2: simplex.Solve2(); break;
+                case 3: simplex.Solve3(); break;
+                default: simplex.v[0].a = 1.0f; break;
+            }
+
+            // The origin is inside the triangle, the cores overlap
+            if (simplex.count == 3)
+                break;
+
+            // The origin is on the simplex, the cores are touching
+            const Vec2 direction = simplex.GetSearchDirection();
+            if (direction.MagnitudeSquared() < 1e-12f)
+                break;
+
+            SimplexVertex vertex = MakeVertex(a, b, direction);
+            ++iterations;
+
+            // No progress towards the origin, the closest feature was found
+            if (simplex.Contains(vertex.w))
+                break;
+            if ((vertex.w - simplex.v[0].w).Dot(direction) <= GJK_TOLERANCE * direction.Magnitude())
+                break;
+
+            simplex.v[simplex.count++] = vertex;
+        }
+        return iterations;
+    }
+
+    void StoreCache(const Simplex& simplex, SimplexCache* cache) {
+        if (!cache) return;
+        cache->count = simplex.count;
+        for (int i = 0; i < simplex.count; i++)
+            cache->directions[i] = simplex.v[i].direction;
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Expanding polytope algorithm, the polytope starts from the
+    // GJK triangle and grows towards the Minkowski boundary
+    ////////////////////////////////////////////////////////////
+    bool RunEPA(const Shape& a, const Shape& b, const Simplex& simplex, PenetrationOutput& output) {
+        std::vector<SimplexVertex> polytope(simplex.v, simplex.v + simplex.count);
+
+        // Grow a degenerate simplex into a triangle
+        if (polytope.size() == 1) {
+            SimplexVertex vertex = MakeVertex(a, b, polytope[0].w * -1.0f);
+            if (vertex.w == polytope[0].w)
+                vertex = MakeVertex(a, b, Vec2(1.0f, 0.0f));
+            polytope.push_back(vertex);
+        }
+        if (polytope.size() == 2) {
+            const Vec2 edge = polytope[1].w - polytope[0].w;
+            SimplexVertex vertex = MakeVertex(a, b, Vec2(-edge.y, edge.x));
+            if (std::abs((vertex.w - polytope[0].w).Cross(edge)) < 1e-6f)
+                vertex = MakeVertex(a, b, Vec2(edge.y, -edge.x));
+            polytope.push_back(vertex);
+        }
+
+        // Make the polytope counter clockwise so the edge normals point outwards
+        const float area = (polytope[1].w - polytope[0].w).Cross(polytope[2].w - polytope[0].w);
+        if (std::abs(area) < 1e-6f)
+            return false;
+        if (area < 0.0f)
+            std::swap(polytope[0], polytope[1]);
+
+        int closestEdge = 0;
+        Vec2 closestNormal{};
+        float closestDistance = 0.0f;
+        for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++) {
+            // Find the polytope edge closest to the origin
+            closestDistance = std::numeric_limits<float>::max();
+            for (int i = 0; i < polytope.size(); i++) {
+                const Vec2& p0 = polytope[i].w;
+                const Vec2& p1 = polytope[(i + 1) % polytope.size()].w;
+                const Vec2 edge = p1 - p0;
+                const Vec2 normal = Vec2(edge.y, -edge.x).Normalize();
+                const float distance = normal.Dot(p0);
+                if (distance < closestDistance) {
+                    closestDistance = distance;
+                    closestNormal = normal;
+                    closestEdge = i;
+                }
+            }
+
+            // Stop when the boundary can't be pushed further along the edge normal
+            SimplexVertex vertex = MakeVertex(a, b, closestNormal);
+            if (vertex.w.Dot(closestNormal) - closestDistance < EPA_TOLERANCE)
+                break;
+
+            polytope.insert(polytope.begin() + closestEdge + 1, vertex);
+        }
+
+        // Witness points from the closest point of the edge to the origin
+        const SimplexVertex& v0 = polytope[closestEdge];
+        const SimplexVertex& v1 = polytope[(closestEdge + 1) % polytope.size()];
+        const Vec2 edge = v1.w - v0.w;
+        const float lengthSquared = edge.MagnitudeSquared();
+        float t = (lengthSquared > 0.0f) ? -v0.w.Dot(edge) / lengthSquared : 0.0f;
+        t = std::fmin(std::fmax(t, 0.0f), 1.0f);
+
+        // The closest boundary point is outside along the edge normal, "b" separates moving against it
+        output.normal = closestNormal * -1.0f;
+        output.depth = closestDistance;
+        output.pointA = v0.wA + (v1.wA - v0.wA) * t;
+        output.pointB = v0.wB + (v1.wB - v0.wB) * t;
+        return true;
+    }
+}
+
+void GJK::Distance(const Shape& a, const Shape& b, DistanceOutput& output, SimplexCache* cache, bool useRadii) {
+    Simplex simplex;
+    output.iterations = RunGJK(a, b, simplex, cache);
+    StoreCache(simplex, cache);
+
+    if (simplex.count == 3) {
+        simplex.GetWitnessPoints(output.pointA, output.pointB);
+        output.pointB = output.pointA;
+        output.distance = 0.0f;
+        return;
+    }
+
+    simplex.GetWitnessPoints(output.pointA, output.pointB);
+    output.distance = (output.pointB - output.pointA).Magnitude();
+
+    // Move the witness points from the cores to the rounded surfaces
+    if (useRadii) {
+        const float radii = a.GetRadius() + b.GetRadius();
+        if (output.distance > radii && output.distance > 0.0f) {
+            const Vec2 normal = (output.pointB - output.pointA) / output.distance;
+            output.distance -= radii;
+            output.pointA += normal * a.GetRadius();
+            output.pointB -= normal * b.GetRadius();
+        } else {
+            // Shapes are overlapping, use the middle point
+            const Vec2 middle = (output.pointA + output.pointB) * 0.5f;
+            output.pointA = middle;
+            output.pointB = middle;
+            output.distance = 0.0f;
+        }
+    }
+}
+
+bool GJK::Penetration(const Shape& a, const Shape& b, PenetrationOutput& output, SimplexCache* cache) {
+    Simplex simplex;
+    RunGJK(a, b, simplex, cache);
+    StoreCache(simplex, cache);
+
+    const float radiusA = a.GetRadius();
+    const float radiusB = b.GetRadius();
+
+    Vec2 pointA, pointB;
+    simplex.GetWitnessPoints(pointA, pointB);
+    const float distance = (pointB - pointA).Magnitude();
+
+    // Cores are apart, only the rounded surfaces can overlap
+    if (simplex.count < 3 && distance > 1e-4f) {
+        const float radii = radiusA + radiusB;
+        if (distance >= radii)
+            return false;
+
+        output.normal = (pointB - pointA) / distance;
+        output.depth = radii - distance;
+        output.pointA = pointA + output.normal * radiusA;
+        output.pointB = pointB - output.normal * radiusB;
+        return true;
+    }
+
+    // Cores overlap, find the penetration of the cores and add the radii
+    if (!RunEPA(a, b, simplex, output))
+        return false;
+
+    output.depth += radiusA + radiusB;
+    output.pointA += output.normal * radiusA;
+    output.pointB -= output.normal * radiusB;
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef GJK_H
+#define GJK_H
+
+#pragma once
+
+#include "Math/Vec2.h"
+
+// Forward declaration
+struct Shape;
+
+// Search directions of the last GJK simplex, used to warm start the next query of the same pair
+struct SimplexCache
+{
+    int count = 0;
+    Vec2 directions[3];
+};
+
+struct DistanceOutput
+{
+    Vec2 pointA{};          // Closest point on "a"
+    Vec2 pointB{};          // Closest point on "b"
+    float distance = 0.0f;  // Distance between "a" and "b", zero when they overlap
+    int iterations = 0;     // Number of GJK iterations
+};
+
+struct PenetrationOutput
+{
+    Vec2 normal{};          // Direction from "a" to "b" in which "b" has to move to separate the shapes
+    Vec2 pointA{};          // Deepest point of "a" inside "b"
+    Vec2 pointB{};          // Deepest point of "b" inside "a"
+    float depth = 0.0f;     // Penetration depth
+};
+
+struct GJK
+{
+    // Closest points between two convex shapes, using their radius when useRadii is set
+    static void Distance(const Shape& a, const Shape& b, DistanceOutput& output, SimplexCache* cache = nullptr, bool useRadii = true);
+
+    // Penetration of two overlapping convex shapes (GJK followed by EPA), returns false if they don't touch
+    static bool Penetration(const Shape& a, const Shape& b, PenetrationOutput& output, SimplexCache* cache = nullptr);
+};
+
+#endif
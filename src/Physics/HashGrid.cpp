@@ -0,0 +1,24 @@
+#include "HashGrid.h"
+
+int HashGrid::GetBucket(int cellX, int cellY) const {
+    const unsigned int hash = static_cast<unsigned int>(cellX) * 73856093u ^ static_cast<unsigned int>(cellY) * 19349663u;
+    return static_cast<int>(hash % (bucketStart.size() - 1));
+}
+
+void HashGrid::Build(const float* x, const float* y, int count) {
+    bucketStart.assign(2 * count + 2, 0);
+    pointBuckets.resize(count);
+    bucketPoints.resize(count);
+
+    for (int i = 0; i < count; i++) {
+        const int bucket = GetBucket(GetCell(x[i]), GetCell(y[i]));
+        pointBuckets[i] = bucket;
+        bucketStart[bucket + 1]++;
+    }
+    for (int b = 1; b < bucketStart.size(); b++)
+        bucketStart[b] += bucketStart[b - 1];
+
+    cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for (int i = 0; i < count; i++)
+        bucketPoints[cursor[pointBuckets[i]]++] = i;
+}
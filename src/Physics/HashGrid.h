@@ -0,0 +1,37 @@
+#ifndef HASHGRID_H
+#define HASHGRID_H
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+////////////////////////////////////////////////////////////
+// Points bucketed by the hash of the square cell they are
+// in, rebuilt from scratch with a counting sort. Twice as
+// many buckets as points keeps the unrelated cells sharing a
+// bucket rare, and they only cost the callers a distance
+// test. Used by the particle systems to find what is near.
+////////////////////////////////////////////////////////////
+class HashGrid
+{
+public:
+    float cellSize = 1.0f;
+
+    void Build(const float* x, const float* y, int count);
+
+    inline int GetCell(float coordinate) const { return static_cast<int>(std::floor(coordinate / cellSize)); }
+    int GetBucket(int cellX, int cellY) const;
+
+    // Points of bucket b, GetPoint(i) for i in [GetBucketStart(b), GetBucketStart(b + 1))
+    inline int GetBucketStart(int bucket) const { return bucketStart[bucket]; }
+    inline int GetPoint(int index) const { return bucketPoints[index]; }
+
+private:
+    std::vector<int> bucketStart;
+    std::vector<int> bucketPoints;
+    std::vector<int> pointBuckets;
+    std::vector<int> cursor;
+};
+
+#endif
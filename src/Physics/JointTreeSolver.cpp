@@ -0,0 +1,335 @@
+#include "JointTreeSolver.h"
+
+#include <algorithm>
+
+#include "./Body.h"
+#include "./Constraint.h"
+
+namespace {
+    // Jacobian of the anchor velocity of a body, rows x and y of the point, column ω from ω × r
+    Mat33 GetAnchorJacobian(const Vec2& r, float sign) {
+        Mat33 out;
+        out.rows[0][0] = sign;  out.rows[0][2] = -r.y * sign;
+        out.rows[1][1] = sign;  out.rows[1][2] = r.x * sign;
+        return out;
+    }
+}
+
+bool JointTreeSolver::IsPinJoint(const Constraint* constraint) {
+    return dynamic_cast<const JointConstraint*>(constraint) || dynamic_cast<const RevoluteJoint*>(constraint);
+}
+
+bool JointTreeSolver::HasAngularRows(const Constraint* constraint) {
+    const RevoluteJoint* revolute = dynamic_cast<const RevoluteJoint*>(constraint);
+    return revolute && (revolute->isLimitEnabled || revolute->isMotorEnabled);
+}
+
+int JointTreeSolver::FindSet(int body) {
+    while (sets[body] != body) {
+        sets[body] = sets[sets[body]];
+        body = sets[body];
+    }
+    return body;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Joints become nodes between the nodes of their dynamic bodies, static bodies
+// all stand for one ground. A union-find over the bodies keeps the joints that
+// grow the trees, a joint whose two ends are already connected closes a loop
+// and is left to the iterative solver, which includes every anchor to the
+// ground past the first one of a tree. The trees are walked from their ground
+// joint, or from a body when they have none, and the reversed walk puts every
+// node before its parent. A joint always has one of its bodies below it, so
+// no pivot is singular.
+///////////////////////////////////////////////////////////////////////////////
+void JointTreeSolver::PreSolve(const std::vector<Constraint*>& constraints, std::vector<Constraint*>& outIterative, float deltaTime) {
+    lastImpulses.clear();
+    for (const Joint& joint: joints)
+        lastImpulses[joint.constraint] = joint.impulse;
+
+    this->deltaTime = deltaTime;
+    nodes.clear();
+    joints.clear();
+    bodyIndices.clear();
+    treeBodies.assign(1, nullptr);
+    sets.assign(1, 0);
+    outIterative.clear();
+
+    // Index 0 is the ground
+    auto getBody = [&](Body* body) {
+        if (body->IsStatic()) return 0;
+        auto it = bodyIndices.find(body);
+        if (it != bodyIndices.end()) return it->second;
+        const int index = static_cast<int>(treeBodies.size());
+        bodyIndices[body] = index;
+        treeBodies.push_back(body);
+        sets.push_back(index);
+        return index;
+    };
+
+    for (Constraint* constraint: constraints) {
+        if (!IsPinJoint(constraint) || constraint->a == constraint->b) {
+            outIterative.push_back(constraint);
+            continue;
+        }
+
+        Joint joint;
+        joint.constraint = constraint;
+        auto impulseIt = lastImpulses.find(constraint);
+        if (impulseIt != lastImpulses.end()) joint.lastImpulse = impulseIt->second;
+        joint.nodeA = getBody(constraint->a);
+        joint.nodeB = getBody(constraint->b);
+        const int setA = FindSet(joint.nodeA);
+        const int setB = FindSet(joint.nodeB);
+        if (setA == setB) {
+            outIterative.push_back(constraint);
+            continue;
+        }
+        sets[std::max(setA, setB)] = std::min(setA, setB);
+        joints.push_back(joint);
+        if (HasAngularRows(constraint)) outIterative.push_back(constraint);
+    }
+    if (joints.empty()) return;
+
+    // Joints of every body
+    const int bodyCount = static_cast<int>(treeBodies.size());
+    const int jointCount = static_cast<int>(joints.size());
+    jointStart.assign(bodyCount + 1, 0);
+    for (const Joint& joint: joints) {
+        jointStart[joint.nodeA + 1]++;
+        jointStart[joint.nodeB + 1]++;
+    }
+    for (int i = 0; i < bodyCount; i++)
+        jointStart[i + 1] += jointStart[i];
+    bodyJoints.resize(jointStart[bodyCount]);
+    cursor.assign(jointStart.begin(), jointStart.end() - 1);
+    for (int j = 0; j < jointCount; j++) {
+        bodyJoints[cursor[joints[j].nodeA]++] = j;
+        bodyJoints[cursor[joints[j].nodeB]++] = j;
+    }
+
+    // Walk the trees from the ground first, parents are added before their children
+    bodyNodes.assign(bodyCount, -1);
+    jointNodes.assign(jointCount, -1);
+    for (int root = 0; root < bodyCount; root++) {
+        if (root > 0 && bodyNodes[root] >= 0) continue;
+
+        if (root > 0) {
+            Node rootNode;
+            rootNode.body = treeBodies[root];
+            bodyNodes[root] = static_cast<int>(nodes.size());
+            nodes.push_back(rootNode);
+        }
+        stack.assign(1, root);
+        while (!stack.empty()) {
+            const int body = stack.back();
+            stack.pop_back();
+            for (int c = jointStart[body]; c < jointStart[body + 1]; c++) {
+                const int j = bodyJoints[c];
+                if (jointNodes[j] >= 0) continue;
+
+                Node jointNode;
+                jointNode.joint = j;
+                jointNode.parent = bodyNodes[body];
+                jointNodes[j] = static_cast<int>(nodes.size());
+                nodes.push_back(jointNode);
+
+                const int other = joints[j].nodeA == body ? joints[j].nodeB : joints[j].nodeA;
+                Node bodyNode;
+                bodyNode.body = treeBodies[other];
+                bodyNode.parent = jointNodes[j];
+                bodyNodes[other] = static_cast<int>(nodes.size());
+                nodes.push_back(bodyNode);
+                stack.push_back(other);
+            }
+        }
+    }
+
+    // Reverse so the leaves come first
+    std::reverse(nodes.begin(), nodes.end());
+    const int nodeCount = static_cast<int>(nodes.size());
+    for (Node& node: nodes) {
+        if (node.parent >= 0) node.parent = nodeCount - 1 - node.parent;
+    }
+    for (int& node: bodyNodes) {
+        if (node >= 0) node = nodeCount - 1 - node;
+    }
+    for (Joint& joint: joints) {
+        joint.nodeA = joint.nodeA > 0 ? bodyNodes[joint.nodeA] : -1;
+        joint.nodeB = joint.nodeB > 0 ? bodyNodes[joint.nodeB] : -1;
+    }
+
+    UpdateAnchors();
+
+    // A joint pulling on an anchor resists the rotation of the body that swings
+    // the anchor off the line of the pull, with a stiffness of r · F. The
+    // linearized step misses it, and once the tension of a long chain makes that
+    // stiffness large for the time step the links start to spin. Adding it to the
+    // rotational mass (dt² * r · F, with the impulses of the last step) keeps the
+    // chains stable at the cost of a little rotational damping. A body that
+    // doesn't rotate keeps a zero inverse and the pull can't turn it.
+    for (Node& node: nodes) {
+        if (node.body) node.angularMass = node.body->I;
+    }
+    for (const Joint& joint: joints) {
+        if (joint.nodeA >= 0) nodes[joint.nodeA].angularMass += deltaTime * std::max(0.0f, -joint.ra.Dot(joint.lastImpulse));
+        if (joint.nodeB >= 0) nodes[joint.nodeB].angularMass += deltaTime * std::max(0.0f, joint.rb.Dot(joint.lastImpulse));
+    }
+    for (Node& node: nodes) {
+        if (node.body && node.body->inverseI > 0.0f) node.inverseAngularMass = 1.0f / node.angularMass;
+    }
+
+    Factor();
+}
+
+float JointTreeSolver::GetInverseI(const Body* body) const {
+    if (nodes.empty()) return body->inverseI;
+    auto it = bodyIndices.find(body);
+    if (it == bodyIndices.end()) return body->inverseI;
+    return nodes[bodyNodes[it->second]].inverseAngularMass;
+}
+
+void JointTreeSolver::UpdateAnchors() {
+    for (Joint& joint: joints) {
+        const Constraint* constraint = joint.constraint;
+        const Vec2 pa = constraint->a->GetWorldPoint(constraint->aPoint);
+        const Vec2 pb = constraint->b->GetWorldPoint(constraint->bPoint);
+        joint.ra = pa - constraint->a->position;
+        joint.rb = pb - constraint->b->position;
+        joint.error = pb - pa;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pivots are eliminated from the leaves to the roots. The pivot of a node is
+// its diagonal block (the mass of a body, zero for a joint) minus the
+// coupling of each child times the child's k, and k = D⁻¹ * coupling to the
+// parent is what the solve passes use.
+///////////////////////////////////////////////////////////////////////////////
+void JointTreeSolver::Factor() {
+    pivots.resize(nodes.size());
+    for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+        Node& node = nodes[i];
+        Mat33& pivot = pivots[i];
+        pivot.Zero();
+        if (node.body) {
+            // A body that doesn't rotate has a unit pivot and no rotation in its jacobians, so its x[2] stays zero
+            pivot.rows[0][0] = node.body->mass;
+            pivot.rows[1][1] = node.body->mass;
+            pivot.rows[2][2] = node.inverseAngularMass > 0.0f ? node.angularMass : 1.0f;
+        } else {
+            pivot.rows[2][2] = 1.0f;
+        }
+
+        // Coupling between the node and its parent, one of them is always a joint
+        if (node.parent < 0) continue;
+        const Node& parent = nodes[node.parent];
+        const Joint& joint = joints[node.body ? parent.joint : node.joint];
+        const int bodyNode = node.body ? i : node.parent;
+        const bool isA = joint.nodeA == bodyNode;
+        const Vec2 r = nodes[bodyNode].inverseAngularMass > 0.0f ? (isA ? joint.ra : joint.rb) : Vec2();
+        const Mat33 jacobian = GetAnchorJacobian(r, isA ? -1.0f : 1.0f);
+
+        // Body to joint: Jᵀ
+        node.coupling = node.body ? jacobian.Transpose() : jacobian;
+    }
+
+    for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+        Node& node = nodes[i];
+        node.inverseD = pivots[i].Inverse();
+        if (node.parent < 0) continue;
+
+        node.k = node.inverseD * node.coupling;
+        const Mat33 update = node.coupling.Transpose() * node.k;
+        Mat33& parentPivot = pivots[node.parent];
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                parentPivot.rows[r][c] -= update.rows[r][c];
+    }
+}
+
+void JointTreeSolver::Substitute() {
+    // Forward substitution, leaves first
+    for (Node& node: nodes) {
+        if (node.parent < 0) continue;
+        const Mat33& k = node.k;
+        float* parentY = nodes[node.parent].y;
+        for (int r = 0; r < 3; r++)
+            parentY[r] -= k.rows[0][r] * node.y[0] + k.rows[1][r] * node.y[1] + k.rows[2][r] * node.y[2];
+    }
+
+    // Back substitution, roots first
+    for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; i--) {
+        Node& node = nodes[i];
+        node.inverseD.Multiply(node.y, node.x);
+        if (node.parent < 0) continue;
+
+        float kx[3];
+        node.k.Multiply(nodes[node.parent].x, kx);
+        for (int r = 0; r < 3; r++)
+            node.x[r] -= kx[r];
+    }
+}
+
+void JointTreeSolver::Solve() {
+    if (nodes.empty()) return;
+
+    // Right hand side: nothing for the bodies, the relative velocity of the anchors for the joints
+    for (Node& node: nodes) {
+        node.y[0] = node.y[1] = node.y[2] = 0.0f;
+        if (node.body) continue;
+
+        const Joint& joint = joints[node.joint];
+        const Body* a = joint.constraint->a;
+        const Body* b = joint.constraint->b;
+        const Vec2 va = a->velocity + Vec2(-a->angularVelocity * joint.ra.y, a->angularVelocity * joint.ra.x);
+        const Vec2 vb = b->velocity + Vec2(-b->angularVelocity * joint.rb.y, b->angularVelocity * joint.rb.x);
+        node.y[0] = va.x - vb.x;
+        node.y[1] = va.y - vb.y;
+    }
+    Substitute();
+
+    // x of a joint is minus its impulse, the impulse on b
+    for (Node& node: nodes) {
+        if (!node.body) {
+            joints[node.joint].impulse -= Vec2(node.x[0], node.x[1]);
+            continue;
+        }
+        node.body->velocity += Vec2(node.x[0], node.x[1]);
+        node.body->angularVelocity += node.x[2];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Same system with the gap between the anchors in place of their relative
+// velocity, solved again from the new positions on every pass since the
+// rotations make it nonlinear. Velocities are left alone.
+///////////////////////////////////////////////////////////////////////////////
+void JointTreeSolver::SolvePositions(int iterations) {
+    if (nodes.empty()) return;
+
+    for (int i = 0; i < iterations; i++) {
+        UpdateAnchors();
+        float maxError = 0.0f;
+        for (const Joint& joint: joints)
+            maxError = std::max(maxError, joint.error.MagnitudeSquared());
+        if (maxError < LINEAR_SLOP * LINEAR_SLOP) break;
+
+        Factor();
+        for (Node& node: nodes) {
+            node.y[0] = node.y[1] = node.y[2] = 0.0f;
+            if (node.body) continue;
+            node.y[0] = -joints[node.joint].error.x;
+            node.y[1] = -joints[node.joint].error.y;
+        }
+        Substitute();
+
+        for (Node& node: nodes) {
+            if (!node.body) continue;
+            Body* body = node.body;
+            body->position += Vec2(node.x[0], node.x[1]);
+            body->rotation += node.x[2];
+            body->shape->UpdateVertices(body->rotation, body->position);
+        }
+    }
+}
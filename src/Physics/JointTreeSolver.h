@@ -0,0 +1,106 @@
+#ifndef JOINTTREESOLVER_H
+#define JOINTTREESOLVER_H
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "./Math/Mat33.h"
+#include "./Math/Vec2.h"
+
+// Forward declaration
+struct Body;
+class Constraint;
+
+////////////////////////////////////////////////////////////
+// Direct solver for the joints of a world whose bodies form
+// a tree (ropes, bridges hanging from static anchors, ragdolls).
+// Each joint pins its two anchor points together in both axes
+// and the whole tree is solved exactly at once by a sparse
+// LDLᵀ factorization of the system
+//   [ M  Jᵀ ] [ Δv ]   [  0  ]
+//   [ J  0  ] [ -λ ] = [ -Jv ]
+// eliminating the leaves first, which costs O(n) and doesn't
+// fill in. Static bodies are all one ground, so a bridge
+// anchored at both ends is a loop. The joints that close a
+// loop are left to the iterative solver, which runs between
+// the direct solves. Revolute joints join the trees by their
+// anchor, a limit or a motor is still solved iteratively.
+////////////////////////////////////////////////////////////
+class JointTreeSolver
+{
+public:
+    // Split the joint constraints into trees, factored with the current body positions and masses.
+    // The constraints the solver doesn't take are written to outIterative
+    void PreSolve(const std::vector<Constraint*>& constraints, std::vector<Constraint*>& outIterative, float deltaTime);
+
+    // Change the velocities so the anchors of every joint of the trees move together, ignoring everything else
+    void Solve();
+
+    // Inverse rotational mass of a body for this step, stiffened by the pull of its joints when it is in a tree.
+    // Contacts solved between the direct solves take it in place of the body's own so they agree with the trees
+    float GetInverseI(const Body* body) const;
+
+    // Move the integrated bodies to close the gaps between the anchors, in up to iterations passes
+    void SolvePositions(int iterations = 3);
+
+    inline int GetJointCount() const { return static_cast<int>(joints.size()); }
+
+private:
+    // Gap between the anchors left alone by the position passes, in pixels
+    static constexpr float LINEAR_SLOP = 0.01f;
+
+    // Body or joint of the trees, in elimination order: every node comes before its parent
+    struct Node {
+        Body* body = nullptr;       // Null for a joint
+        int joint = -1;
+        int parent = -1;
+        float angularMass = 0.0f;   // Rotational mass of a body stiffened by the pull of its joints
+        float inverseAngularMass = 0.0f; // Zero for a body that doesn't rotate
+        Mat33 coupling{};           // Block of the system between the node and its parent
+        Mat33 inverseD{};           // Inverse of the pivot block
+        Mat33 k{};                  // inverseD * coupling
+        float y[3] = {};
+        float x[3] = {};
+    };
+
+    // Joint of the trees, one entry per joint
+    struct Joint {
+        Constraint* constraint = nullptr;
+        Vec2 ra{}, rb{};            // Anchors relative to the body centers
+        Vec2 error{};               // Gap from the anchor on a to the anchor on b
+        Vec2 impulse{};             // Impulse on b over the step, a gets the opposite
+        Vec2 lastImpulse{};         // Impulse of the last step, for the stiffness of the pull
+        int nodeA = -1, nodeB = -1; // Body nodes, -1 for a static body
+    };
+
+    float deltaTime = 0.0f;
+    std::vector<Node> nodes;
+    std::vector<Joint> joints;
+    std::unordered_map<const Constraint*, Vec2> lastImpulses;
+
+    // Scratch of the tree building, reused between steps
+    std::unordered_map<const Body*, int> bodyIndices;
+    std::vector<Body*> treeBodies;
+    std::vector<int> sets;
+    std::vector<int> jointStart, bodyJoints, cursor;
+    std::vector<int> bodyNodes, jointNodes;
+    std::vector<int> stack;
+    std::vector<Mat33> pivots;      // 3x3 blocks of the system, 2x2 joint blocks are padded with an identity row
+
+    // Joint that pins two anchors together, the trees solve the anchors of revolute joints too
+    static bool IsPinJoint(const Constraint* constraint);
+
+    // Revolute joint with a limit or a motor, whose relative rotation is left to the iterative solver
+    static bool HasAngularRows(const Constraint* constraint);
+
+    int FindSet(int body);
+    void UpdateAnchors();
+    void Factor();
+
+    // Solve the factored system for the right hand side in the y of the nodes, into their x
+    void Substitute();
+};
+
+#endif
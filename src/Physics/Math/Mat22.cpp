@@ -0,0 +1,32 @@
+#include "Mat22.h"
+
+Mat22::Mat22(float a11, float a12, float a21, float a22) {
+    rows[0][0] = a11;
+    rows[0][1] = a12;
+    rows[1][0] = a21;
+    rows[1][1] = a22;
+}
+
+void Mat22::Zero() {
+    rows[0][0] = rows[0][1] = rows[1][0] = rows[1][1] = 0.0f;
+}
+
+float Mat22::Determinant() const {
+    return rows[0][0] * rows[1][1] - rows[0][1] * rows[1][0];
+}
+
+Mat22 Mat22::Inverse() const {
+    float det = Determinant();
+    if (det != 0.0f) det = 1.0f / det;
+    return Mat22(det * rows[1][1], -det * rows[0][1], -det * rows[1][0], det * rows[0][0]);
+}
+
+Vec2 Mat22::Solve(const Vec2& b) const {
+    float det = Determinant();
+    if (det != 0.0f) det = 1.0f / det;
+    return Vec2(det * (rows[1][1] * b.x - rows[0][1] * b.y), det * (rows[0][0] * b.y - rows[1][0] * b.x));
+}
+
+Vec2 Mat22::operator * (const Vec2& v) const {
+    return Vec2(rows[0][0] * v.x + rows[0][1] * v.y, rows[1][0] * v.x + rows[1][1] * v.y);
+}
@@ -0,0 +1,26 @@
+#ifndef MAT22_H
+#define MAT22_H
+
+#include "Vec2.h"
+
+// Fixed size 2x2 matrix for the effective masses of the joints, no allocation
+struct Mat22 {
+    float rows[2][2] = {{0.0f, 0.0f}, {0.0f, 0.0f}};
+
+    Mat22() = default;
+    Mat22(float a11, float a12, float a21, float a22);
+
+    void Zero();
+    float Determinant() const;
+
+    // Zero matrix when singular
+    Mat22 Inverse() const;
+
+    // x in A * x = b, zero when singular
+    Vec2 Solve(const Vec2& b) const;
+
+    // Override operators
+    Vec2 operator * (const Vec2& v) const;     // m1 * v
+};
+
+#endif
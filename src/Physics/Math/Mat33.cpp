@@ -0,0 +1,52 @@
+#include "Mat33.h"
+
+void Mat33::Zero() {
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            rows[i][j] = 0.0f;
+}
+
+float Mat33::Determinant() const {
+    return rows[0][0] * (rows[1][1] * rows[2][2] - rows[1][2] * rows[2][1])
+         - rows[0][1] * (rows[1][0] * rows[2][2] - rows[1][2] * rows[2][0])
+         + rows[0][2] * (rows[1][0] * rows[2][1] - rows[1][1] * rows[2][0]);
+}
+
+// Adjugate over the determinant
+Mat33 Mat33::Inverse() const {
+    float det = Determinant();
+    if (det != 0.0f) det = 1.0f / det;
+
+    Mat33 result;
+    result.rows[0][0] = det * (rows[1][1] * rows[2][2] - rows[1][2] * rows[2][1]);
+    result.rows[0][1] = det * (rows[0][2] * rows[2][1] - rows[0][1] * rows[2][2]);
+    result.rows[0][2] = det * (rows[0][1] * rows[1][2] - rows[0][2] * rows[1][1]);
+    result.rows[1][0] = det * (rows[1][2] * rows[2][0] - rows[1][0] * rows[2][2]);
+    result.rows[1][1] = det * (rows[0][0] * rows[2][2] - rows[0][2] * rows[2][0]);
+    result.rows[1][2] = det * (rows[0][2] * rows[1][0] - rows[0][0] * rows[1][2]);
+    result.rows[2][0] = det * (rows[1][0] * rows[2][1] - rows[1][1] * rows[2][0]);
+    result.rows[2][1] = det * (rows[0][1] * rows[2][0] - rows[0][0] * rows[2][1]);
+    result.rows[2][2] = det * (rows[0][0] * rows[1][1] - rows[0][1] * rows[1][0]);
+    return result;
+}
+
+Mat33 Mat33::Transpose() const {
+    Mat33 result;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            result.rows[i][j] = rows[j][i];
+    return result;
+}
+
+void Mat33::Multiply(const float v[3], float out[3]) const {
+    for (int i = 0; i < 3; i++)
+        out[i] = rows[i][0] * v[0] + rows[i][1] * v[1] + rows[i][2] * v[2];
+}
+
+Mat33 Mat33::operator * (const Mat33& m) const {
+    Mat33 result;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            result.rows[i][j] = rows[i][0] * m.rows[0][j] + rows[i][1] * m.rows[1][j] + rows[i][2] * m.rows[2][j];
+    return result;
+}
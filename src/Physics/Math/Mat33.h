@@ -0,0 +1,24 @@
+#ifndef MAT33_H
+#define MAT33_H
+
+// Fixed size 3x3 matrix for the effective masses of the joints, no allocation
+struct Mat33 {
+    float rows[3][3] = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+    Mat33() = default;
+
+    void Zero();
+    float Determinant() const;
+
+    // Zero matrix when singular
+    Mat33 Inverse() const;
+    Mat33 Transpose() const;
+
+    // out = m1 * v
+    void Multiply(const float v[3], float out[3]) const;
+
+    // Override operators
+    Mat33 operator * (const Mat33& m) const;   // m1 * m2
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include "ParticleCollider.h"
+
+#include "./Body.h"
+#include "./CollisionDetection.h"
+#include "./World.h"
+
+ParticleCollider::ParticleCollider() {
+    probe = new Body(CircleShape(1.0f), 0.0f, 0.0f, 1.0f);
+}
+
+ParticleCollider::~ParticleCollider() {
+    CollisionDetection::ClearCache(probe);
+    delete probe;
+}
+
+void ParticleCollider::QueryBodies(World &world, const AABB &box, std::vector<Body*> &outBodies) {
+    probe->categoryBits = categoryBits;
+    probe->maskBits = maskBits;
+    probe->groupIndex = groupIndex;
+
+    // Room for every body, so none is dropped before the filter rules it out
+    found.resize(world.GetBodies().size());
+    const int foundCount = world.QueryAABB(box, found.data(), static_cast<int>(found.size()));
+    for (int b = 0; b < foundCount; b++) {
+        if (!found[b]->isSensor && found[b]->ShouldCollide(*probe))
+            outBodies.push_back(found[b]);
+    }
+}
+
+bool ParticleCollider::GetDeepestContact(Body *body, const Vec2 &center, float radius, Contact &outContact) {
+    return CollisionDetection::GetDeepestProbeContact(body, probe, center, radius, contacts, outContact);
+}
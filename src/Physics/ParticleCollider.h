@@ -0,0 +1,51 @@
+#ifndef PARTICLECOLLIDER_H
+#define PARTICLECOLLIDER_H
+
+#pragma once
+
+#include <vector>
+
+#include "AABB.h"
+#include "Contact.h"
+#include "Math/Vec2.h"
+
+// Forward declaration
+struct Body;
+class World;
+
+////////////////////////////////////////////////////////////
+// How the particles of a particle system collide with the
+// world bodies: the filter they collide with, the bodies the
+// broadphase and the filter let through, and a circle probe
+// body moved onto a particle to run the narrowphase against
+// one of them.
+////////////////////////////////////////////////////////////
+class ParticleCollider
+{
+public:
+    ParticleCollider();
+    ~ParticleCollider();
+
+    ParticleCollider(const ParticleCollider&) = delete;
+    ParticleCollider& operator=(const ParticleCollider&) = delete;
+
+    // Collision filtering against the world bodies, same rules as Body
+    unsigned int categoryBits = 0x0001;
+    unsigned int maskBits = 0xFFFFFFFF;
+    int groupIndex = 0;
+
+    // Appends the bodies whose bounding box overlaps the box and that the particles collide with, sensors left out
+    void QueryBodies(World& world, const AABB& box, std::vector<Body*>& outBodies);
+
+    // Deepest contact of a particle circle at center against body. False when they don't overlap
+    bool GetDeepestContact(Body* body, const Vec2& center, float radius, Contact& outContact);
+
+private:
+    Body* probe = nullptr;
+    std::vector<Contact> contacts;
+
+    // Bodies of the last broadphase query, room for every body of the world
+    std::vector<Body*> found;
+};
+
+#endif
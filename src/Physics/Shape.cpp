@@ -1,9 +1,46 @@
 #include "Shape.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
 #include <iostream>
 
+namespace {
+    // Ray start + delta * t against a circle, for t in [0, maxFraction]
+    bool RayCastCircle(const Vec2& start, const Vec2& delta, const Vec2& center, float radius, float maxFraction, RayCastOutput& output) {
+        const Vec2 s = start - center;
+        const float c = s.Dot(s) - radius * radius;
+        if (c < 0.0f) return false;
+
+        const float a = delta.Dot(delta);
+        const float b = s.Dot(delta);
+        const float discriminant = b * b - a * c;
+        if (discriminant < 0.0f || a <= 0.0f) return false;
+
+        const float t = -(b + std::sqrt(discriminant)) / a;
+        if (t < 0.0f || t > maxFraction) return false;
+
+        output.fraction = t;
+        output.normal = (s + delta * t).UnitVector();
+        return true;
+    }
+}
+
+// --------------------
+// Shape
+// --------------------
+
+int Shape::RayCastPacket(const Vec2* starts, const Vec2* ends, const float* maxFractions, int laneMask, RayCastOutput* outputs) const
+{
+    int hitMask = 0;
+    for (int i = 0; i < BVH::PACKET_SIZE; i++) {
+        if ((laneMask & (1 << i)) && RayCast(starts[i], ends[i], maxFractions[i], outputs[i]))
+            hitMask |= 1 << i;
+    }
+    return hitMask;
+}
+
 // --------------------
 // CircleShape
 // --------------------
@@ -17,7 +54,57 @@ float CircleShape::GetMomentOfInertia() const
 
 void CircleShape::UpdateVertices(float angle, const Vec2& position)
 {
-	// Do nothing
+	// Nothing to rotate, only keep track of the center
+	center = position;
+}
+
+AABB CircleShape::GetAABB() const
+{
+    return AABB(center - Vec2(radius, radius), center + Vec2(radius, radius));
+}
+
+bool CircleShape::RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const
+{
+    return RayCastCircle(start, end - start, center, radius, maxFraction, output);
+}
+
+int CircleShape::RayCastPacket(const Vec2* starts, const Vec2* ends, const float* maxFractions, int laneMask, RayCastOutput* outputs) const
+{
+    // Same test as RayCastCircle, solved for all the lanes at once without branches
+    float fractions[BVH::PACKET_SIZE];
+    int isHit[BVH::PACKET_SIZE];
+    for (int i = 0; i < BVH::PACKET_SIZE; i++) {
+        const float sx = starts[i].x - center.x;
+        const float sy = starts[i].y - center.y;
+        const float dx = ends[i].x - starts[i].x;
+        const float dy = ends[i].y - starts[i].y;
+
+        const float a = dx * dx + dy * dy;
+        const float b = sx * dx + sy * dy;
+        const float c = sx * sx + sy * sy - radius * radius;
+        const float discriminant = b * b - a * c;
+        const float t = -(b + std::sqrt(std::max(discriminant, 0.0f))) / std::max(a, 1e-12f);
+
+        fractions[i] = t;
+        isHit[i] = (c >= 0.0f) & (discriminant >= 0.0f) & (a > 0.0f) & (t >= 0.0f) & (t <= maxFractions[i]);
+    }
+
+    int hitMask = 0;
+    for (int i = 0; i < BVH::PACKET_SIZE; i++)
+        hitMask |= isHit[i] << i;
+    hitMask &= laneMask;
+
+    for (int i = 0; i < BVH::PACKET_SIZE; i++) {
+        if (!(hitMask & (1 << i))) continue;
+        outputs[i].fraction = fractions[i];
+        outputs[i].normal = (starts[i] + (ends[i] - starts[i]) * fractions[i] - center).UnitVector();
+    }
+    return hitMask;
+}
+
+bool CircleShape::TestPoint(const Vec2& point) const
+{
+    return (point - center).MagnitudeSquared() <= radius * radius;
 }
 
 // --------------------
@@ -28,6 +115,13 @@ PolygonShape::PolygonShape(const std::vector<Vec2> &vertices) : localVertices(ve
 {
     // Resize the world vertices to match the number of local vertices
     worldVertices.resize(localVertices.size());
+
+    // Find the farthest vertex from the origin for the bounding circle
+    float maxDistanceSquared = 0.0f;
+    for (const Vec2& vertex: localVertices) {
+        maxDistanceSquared = std::max(maxDistanceSquared, vertex.MagnitudeSquared());
+    }
+    boundingRadius = std::sqrt(maxDistanceSquared);
 }
 
 float PolygonShape::GetMomentOfInertia() const
@@ -54,28 +148,113 @@ Vec2 PolygonShape::GetNormal(int index) const
     return edge.Normal();
 }
 
-float PolygonShape::FindMinSeparation(const PolygonShape& other, int &outIndexReferenceEdge, Vec2& outSupportPoint) const
+Vec2 PolygonShape::GetSupportPoint(const Vec2& direction) const
+{
+    return worldVertices[FindSupportIndex(direction)];
+}
+
+AABB PolygonShape::GetAABB() const
+{
+    AABB box(worldVertices[0], worldVertices[0]);
+    for (const Vec2& vertex: worldVertices)
+        box = box.Union(AABB(vertex, vertex));
+    return box;
+}
+
+////////////////////////////////////////////////////////////
+// Clip the ray parameter range against the half plane of
+// every edge, the hit is where the ray enters the last one
+////////////////////////////////////////////////////////////
+bool PolygonShape::RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const
+{
+    const Vec2 delta = end - start;
+    float lower = 0.0f;
+    float upper = maxFraction;
+    int index = -1;
+
+    for (int i = 0; i < worldVertices.size(); i++) {
+        const Vec2 normal = GetNormal(i);
+        const float numerator = normal.Dot(worldVertices[i] - start);
+        const float denominator = normal.Dot(delta);
+
+        if (denominator == 0.0f) {
+            // Parallel to the edge and outside of it
+            if (numerator < 0.0f) return false;
+        } else if (denominator < 0.0f && numerator < lower * denominator) {
+            // Entering the half plane
+            lower = numerator / denominator;
+            index = i;
+        } else if (denominator > 0.0f && numerator < upper * denominator) {
+            // Leaving the half plane
+            upper = numerator / denominator;
+        }
+
+        if (upper < lower) return false;
+    }
+
+    // No entering edge means the ray starts inside
+    if (index < 0) return false;
+
+    output.fraction = lower;
+    output.normal = GetNormal(index);
+    return true;
+}
+
+bool PolygonShape::TestPoint(const Vec2& point) const
+{
+    // Behind every edge of the convex polygon
+    for (int i = 0; i < worldVertices.size(); i++) {
+        if (GetNormal(i).Dot(point - worldVertices[i]) > 0.0f)
+            return false;
+    }
+    return true;
+}
+
+int PolygonShape::FindSupportIndex(const Vec2& direction, int startIndex) const
+{
+    const int count = static_cast<int>(worldVertices.size());
+    int index = ((startIndex % count) + count) % count;
+    float maxProjection = worldVertices[index].Dot(direction);
+
+    // Pick the neighbour that goes uphill, if none does the start is already the support point
+    int step = 1;
+    float nextProjection = worldVertices[(index + 1) % count].Dot(direction);
+    if (nextProjection <= maxProjection) {
+        step = count - 1;
+        nextProjection = worldVertices[(index + step) % count].Dot(direction);
+        if (nextProjection <= maxProjection)
+            return index;
+    }
+
+    // On a convex ring the projection is unimodal, keep walking while it increases
+    for (int i = 0; i < count && nextProjection > maxProjection; i++) {
+        index = (index + step) % count;
+        maxProjection = nextProjection;
+        nextProjection = worldVertices[(index + step) % count].Dot(direction);
+    }
+    return index;
+}
+
+float PolygonShape::FindMinSeparation(const PolygonShape& other, int &outIndexReferenceEdge, Vec2& outSupportPoint, int &inOutSupportIndex) const
 {
     float separation = std::numeric_limits<float>::lowest();
 
+    // Consecutive edge normals rotate monotonically, so each support search starts from the previous one
+    int supportIndex = inOutSupportIndex;
     for (int i = 0; i < worldVertices.size(); ++i)
     {
-        float minSep = std::numeric_limits<float>::max();
-        Vec2 minVertex;
         Vec2 va = worldVertices[i];
         Vec2 normal = GetNormal(i);
 
-        for (int j = 0; j < other.worldVertices.size(); ++j)
-        {
-            Vec2 vb = other.worldVertices[j];
-            float projection = (vb - va).Dot(normal);
-
-            // Keep track of the smallest separation and the min vertex
-            if (projection < minSep)
-            {
-                minSep = projection;
-                minVertex = vb;
-            }
+        // The deepest vertex of the other polygon is its support point against the normal
+        supportIndex = other.FindSupportIndex(normal * -1.0f, supportIndex);
+        const Vec2& minVertex = other.worldVertices[supportIndex];
+        float minSep = (minVertex - va).Dot(normal);
+
+        // Early out, this edge is a separating axis
+        if (minSep >= 0) {
+            inOutSupportIndex = supportIndex;
+            return minSep;
         }
 
         // Keep track of the best separation
@@ -87,6 +266,7 @@ float PolygonShape::FindMinSeparation(const PolygonShape& other, int &outIndexRe
         }
     }
 
+    inOutSupportIndex = supportIndex;
     return separation;
 }
 
@@ -100,16 +280,25 @@ void PolygonShape::UpdateVertices(float angle, const Vec2& position)
     }
 }
 
-int PolygonShape::FindIncidentEdge(const Vec2 &normal) const {
-    int indexIncidentEdge = 0;
-    float minDot = std::numeric_limits<float>::max();
-    for (int i = 0; i < this->worldVertices.size(); ++i) {
-        auto edgeNormal = this->GetEdge(i).Normal();
-        auto projection = edgeNormal.Dot(normal);
-        if (projection < minDot) {
-            minDot = projection;
-            indexIncidentEdge = i;
-        }
+int PolygonShape::FindIncidentEdge(const Vec2 &normal, int startIndex) const {
+    const int count = static_cast<int>(worldVertices.size());
+    int indexIncidentEdge = ((startIndex % count) + count) % count;
+    float minDot = GetNormal(indexIncidentEdge).Dot(normal);
+
+    // Edge normals of a convex polygon are sorted by angle, walk downhill from the start edge
+    int step = 1;
+    float nextDot = GetNormal((indexIncidentEdge + 1) % count).Dot(normal);
+    if (nextDot >= minDot) {
+        step = count - 1;
+        nextDot = GetNormal((indexIncidentEdge + step) % count).Dot(normal);
+        if (nextDot >= minDot)
+            return indexIncidentEdge;
+    }
+
+    for (int i = 0; i < count && nextDot < minDot; i++) {
+        indexIncidentEdge = (indexIncidentEdge + step) % count;
+        minDot = nextDot;
+        nextDot = GetNormal((indexIncidentEdge + step) % count).Dot(normal);
     }
     return indexIncidentEdge;
 }
@@ -157,4 +346,346 @@ BoxShape::BoxShape(float width, float height) : PolygonShape({
 float BoxShape::GetMomentOfInertia() const
 {
     return 0.083333 * (width * width + height * height);
-}
\ No newline at end of file
+}
+
+void BoxShape::UpdateVertices(float angle, const Vec2& position)
+{
+    // Cache the rotation as the two local axes in world space
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    axisX = Vec2(c, s);
+    axisY = Vec2(-s, c);
+    center = position;
+
+    const Vec2 halfX = axisX * (width * 0.5f);
+    const Vec2 halfY = axisY * (height * 0.5f);
+
+    worldVertices[0] = center - halfX - halfY;
+    worldVertices[1] = center + halfX - halfY;
+    worldVertices[2] = center + halfX + halfY;
+    worldVertices[3] = center - halfX + halfY;
+}
+
+////////////////////////////////////////////////////////////
+// Edge "i" goes from vertex i to vertex i+1:
+// 0: bottom (-y), 1: right (+x), 2: top (+y), 3: left (-x)
+////////////////////////////////////////////////////////////
+Vec2 BoxShape::GetFaceNormal(int index) const
+{
+    switch (index) {
+        case 0: return Vec2(-axisY.x, -axisY.y);
+        case 1: return axisX;
+        case 2: return axisY;
+        default: return Vec2(-axisX.x, -axisX.y);
+    }
+}
+
+float BoxShape::FindMinSeparation(const BoxShape& other, int &outIndexReferenceEdge) const
+{
+    // Center offset and the other box axes, expressed in this box frame
+    const Vec2 d = other.center - center;
+    const float dx = d.Dot(axisX);
+    const float dy = d.Dot(axisY);
+
+    // Projected half extents of the other box onto this box axes
+    const float otherHalfW = other.width * 0.5f;
+    const float otherHalfH = other.height * 0.5f;
+    const float otherExtentX = otherHalfW * std::abs(axisX.Dot(other.axisX)) + otherHalfH * std::abs(axisX.Dot(other.axisY));
+    const float otherExtentY = otherHalfW * std::abs(axisY.Dot(other.axisX)) + otherHalfH * std::abs(axisY.Dot(other.axisY));
+
+    // Separation along each face normal, in edge order
+    const float separations[4] = {
+        -dy - height * 0.5f - otherExtentY,
+         dx - width * 0.5f - otherExtentX,
+         dy - height * 0.5f - otherExtentY,
+        -dx - width * 0.5f - otherExtentX
+    };
+
+    float separation = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < 4; ++i) {
+        if (separations[i] > separation) {
+            separation = separations[i];
+            outIndexReferenceEdge = i;
+        }
+    }
+
+    return separation;
+}
+
+int BoxShape::FindIncidentEdge(const Vec2 &normal) const
+{
+    const float dotX = axisX.Dot(normal);
+    const float dotY = axisY.Dot(normal);
+
+    // Projection of each face normal onto the reference normal, in edge order
+    const float projections[4] = { -dotY, dotX, dotY, -dotX };
+
+    int indexIncidentEdge = 0;
+    float minDot = std::numeric_limits<float>::max();
+    for (int i = 0; i < 4; ++i) {
+        if (projections[i] < minDot) {
+            minDot = projections[i];
+            indexIncidentEdge = i;
+        }
+    }
+    return indexIncidentEdge;
+}
+
+bool BoxShape::RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const
+{
+    // Ray in the box frame
+    const Vec2 offset = start - center;
+    const Vec2 delta = end - start;
+    const float starts[2] = {offset.Dot(axisX), offset.Dot(axisY)};
+    const float deltas[2] = {delta.Dot(axisX), delta.Dot(axisY)};
+    const float halfExtents[2] = {width * 0.5f, height * 0.5f};
+
+    float lower = 0.0f;
+    float upper = maxFraction;
+    int index = -1;
+    for (int axis = 0; axis < 2; axis++) {
+        if (deltas[axis] == 0.0f) {
+            if (std::abs(starts[axis]) > halfExtents[axis]) return false;
+            continue;
+        }
+
+        // Entering through the face on the side the ray comes from
+        const float sign = deltas[axis] > 0.0f ? -1.0f : 1.0f;
+        const float tEnter = (sign * halfExtents[axis] - starts[axis]) / deltas[axis];
+        const float tLeave = (-sign * halfExtents[axis] - starts[axis]) / deltas[axis];
+        if (tEnter > lower) {
+            lower = tEnter;
+            // Face order: 0 -y, 1 +x, 2 +y, 3 -x
+            index = axis == 0 ? (sign > 0.0f ? 1 : 3) : (sign > 0.0f ? 2 : 0);
+        }
+        upper = std::min(upper, tLeave);
+        if (upper < lower) return false;
+    }
+
+    if (index < 0) return false;
+
+    output.fraction = lower;
+    output.normal = GetFaceNormal(index);
+    return true;
+}
+
+bool BoxShape::TestPoint(const Vec2& point) const
+{
+    const Vec2 offset = point - center;
+    return std::abs(offset.Dot(axisX)) <= width * 0.5f && std::abs(offset.Dot(axisY)) <= height * 0.5f;
+}
+
+// --------------------
+// CapsuleShape
+// --------------------
+
+CapsuleShape::CapsuleShape(float length, float radius) : length(length), radius(radius) {}
+
+////////////////////////////////////////////////////////////
+// Rectangle (2r x length) plus the two half discs of the
+// caps, weighted by area and moved to the capsule center
+////////////////////////////////////////////////////////////
+float CapsuleShape::GetMomentOfInertia() const
+{
+    const float pi = 3.14159265f;
+    const float rectArea = 2.0f * radius * length;
+    const float circleArea = pi * radius * radius;
+
+    const float rectI = rectArea * (4.0f * radius * radius + length * length) / 12.0f;
+    const float capOffset = 4.0f * radius / (3.0f * pi);
+    const float circleI = circleArea * (0.5f * radius * radius + 0.25f * length * length + length * capOffset);
+
+    return (rectI + circleI) / (rectArea + circleArea);
+}
+
+void CapsuleShape::UpdateVertices(float angle, const Vec2& position)
+{
+    const Vec2 halfSegment = Vec2(0.0f, length * 0.5f).Rotate(angle);
+    worldPoint1 = position - halfSegment;
+    worldPoint2 = position + halfSegment;
+}
+
+Vec2 CapsuleShape::GetSupportPoint(const Vec2& direction) const
+{
+    return (worldPoint2 - worldPoint1).Dot(direction) > 0.0f ? worldPoint2 : worldPoint1;
+}
+
+AABB CapsuleShape::GetAABB() const
+{
+    const AABB segment = AABB(worldPoint1, worldPoint1).Union(AABB(worldPoint2, worldPoint2));
+    return AABB(segment.min - Vec2(radius, radius), segment.max + Vec2(radius, radius));
+}
+
+////////////////////////////////////////////////////////////
+// The surface is made of the two cap circles and the two
+// sides parallel to the core, the first one hit wins
+////////////////////////////////////////////////////////////
+bool CapsuleShape::RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const
+{
+    const Vec2 delta = end - start;
+    const Vec2 axis = worldPoint2 - worldPoint1;
+    const float axisLengthSquared = axis.MagnitudeSquared();
+
+    // Starting inside the capsule
+    const float t = axisLengthSquared > 0.0f ? std::clamp((start - worldPoint1).Dot(axis) / axisLengthSquared, 0.0f, 1.0f) : 0.0f;
+    if ((start - (worldPoint1 + axis * t)).MagnitudeSquared() < radius * radius) return false;
+
+    bool isHit = false;
+    RayCastOutput capOutput;
+    for (const Vec2& cap: {worldPoint1, worldPoint2}) {
+        if (RayCastCircle(start, delta, cap, radius, maxFraction, capOutput)) {
+            maxFraction = capOutput.fraction;
+            output = capOutput;
+            isHit = true;
+        }
+    }
+
+    if (axisLengthSquared <= 0.0f) return isHit;
+
+    const Vec2 sideNormal = axis.Normal();
+    for (const float side: {1.0f, -1.0f}) {
+        const Vec2 normal = sideNormal * side;
+        const float denominator = normal.Dot(delta);
+        if (denominator >= 0.0f) continue;
+
+        const Vec2 sidePoint = worldPoint1 + normal * radius;
+        const float fraction = normal.Dot(sidePoint - start) / denominator;
+        if (fraction < 0.0f || fraction > maxFraction) continue;
+
+        // The hit has to fall between the caps
+        const float along = (start + delta * fraction - sidePoint).Dot(axis);
+        if (along < 0.0f || along > axisLengthSquared) continue;
+
+        maxFraction = fraction;
+        output.fraction = fraction;
+        output.normal = normal;
+        isHit = true;
+    }
+    return isHit;
+}
+
+bool CapsuleShape::TestPoint(const Vec2& point) const
+{
+    // Within the radius of the closest point of the core segment
+    const Vec2 axis = worldPoint2 - worldPoint1;
+    const float axisLengthSquared = axis.MagnitudeSquared();
+    const float t = axisLengthSquared > 0.0f ? std::clamp((point - worldPoint1).Dot(axis) / axisLengthSquared, 0.0f, 1.0f) : 0.0f;
+    return (point - (worldPoint1 + axis * t)).MagnitudeSquared() <= radius * radius;
+}
+
+// --------------------
+// ChainShape
+// --------------------
+
+ChainShape::ChainShape(const std::vector<Vec2> &vertices, bool isLoop) : localVertices(vertices), worldVertices(vertices), isLoop(isLoop) {}
+
+float ChainShape::GetMomentOfInertia() const
+{
+    // Chains are meant for static bodies
+    return 0.0f;
+}
+
+void ChainShape::UpdateVertices(float angle, const Vec2& position)
+{
+    for (int i = 0; i < localVertices.size(); i++) {
+        worldVertices[i] = localVertices[i].Rotate(angle);
+        worldVertices[i] += position;
+    }
+
+    // Rebuild the segment hierarchy, cheap enough since chains don't move
+    std::vector<AABB> boxes(GetSegmentCount());
+    for (int i = 0; i < boxes.size(); i++) {
+        const Vec2& v1 = worldVertices[i];
+        const Vec2& v2 = worldVertices[(i + 1) % worldVertices.size()];
+        boxes[i] = AABB(v1, v1).Union(AABB(v2, v2));
+    }
+    tree.Build(boxes);
+}
+
+Vec2 ChainShape::GetSupportPoint(const Vec2& direction) const
+{
+    Vec2 support = worldVertices[0];
+    for (const Vec2& vertex: worldVertices) {
+        if (vertex.Dot(direction) > support.Dot(direction))
+            support = vertex;
+    }
+    return support;
+}
+
+AABB ChainShape::GetAABB() const
+{
+    AABB box(worldVertices[0], worldVertices[0]);
+    for (const Vec2& vertex: worldVertices)
+        box = box.Union(AABB(vertex, vertex));
+    return box;
+}
+
+bool ChainShape::RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const
+{
+    const Vec2 delta = end - start;
+    bool isHit = false;
+
+    tree.RayCast(start, end, maxFraction, [&](int index) {
+        const Vec2& v1 = worldVertices[index];
+        const Vec2& v2 = worldVertices[(index + 1) % worldVertices.size()];
+        const Vec2 edge = v2 - v1;
+        const Vec2 normal = edge.Normal();
+
+        // One-sided, the ray has to come from the front
+        const float denominator = normal.Dot(delta);
+        if (denominator >= 0.0f) return maxFraction;
+
+        const float fraction = normal.Dot(v1 - start) / denominator;
+        if (fraction < 0.0f || fraction > maxFraction) return maxFraction;
+
+        const float along = (start + delta * fraction - v1).Dot(edge);
+        if (along < 0.0f || along > edge.MagnitudeSquared()) return maxFraction;
+
+        maxFraction = fraction;
+        output.fraction = fraction;
+        output.normal = normal;
+        isHit = true;
+        return maxFraction;
+    });
+    return isHit;
+}
+
+int ChainShape::GetSegmentCount() const
+{
+    const int count = static_cast<int>(worldVertices.size());
+    return isLoop ? count : count - 1;
+}
+
+ChainSegment ChainShape::GetSegment(int index) const
+{
+    const int count = static_cast<int>(worldVertices.size());
+    ChainSegment segment;
+    segment.hasPrevious = isLoop || index > 0;
+    segment.hasNext = isLoop || index + 2 < count;
+
+    segment.v1 = worldVertices[index];
+    segment.v2 = worldVertices[(index + 1) % count];
+    segment.v0 = segment.hasPrevious ? worldVertices[(index - 1 + count) % count] : segment.v1;
+    segment.v3 = segment.hasNext ? worldVertices[(index + 2) % count] : segment.v2;
+    segment.normal = (segment.v2 - segment.v1).Normal();
+
+    // Same winding as a convex polygon, so a positive turn bends away from the normal
+    const Vec2 edge0 = segment.v1 - segment.v0;
+    const Vec2 edge1 = segment.v2 - segment.v1;
+    const Vec2 edge2 = segment.v3 - segment.v2;
+    segment.isConvex1 = segment.hasPrevious && edge0.Cross(edge1) > 0.005f * edge0.Magnitude() * edge1.Magnitude();
+    segment.isConvex2 = segment.hasNext && edge1.Cross(edge2) > 0.005f * edge1.Magnitude() * edge2.Magnitude();
+    return segment;
+}
+
+CapsuleShape ChainShape::GetSegmentShape(int index) const
+{
+    const Vec2& v1 = worldVertices[index];
+    const Vec2& v2 = worldVertices[(index + 1) % worldVertices.size()];
+    const Vec2 edge = v2 - v1;
+
+    // The capsule core goes along its local y axis, rotate it onto the segment
+    CapsuleShape segmentShape(edge.Magnitude(), 0.0f);
+    segmentShape.UpdateVertices(std::atan2(-edge.x, edge.y), (v1 + v2) * 0.5f);
+    return segmentShape;
+}
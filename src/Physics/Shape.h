@@ -5,11 +5,22 @@
 
 #include <vector>
 #include "Math/Vec2.h"
+#include "AABB.h"
+#include "BVH.h"
 
 enum class ShapeType {
     CIRCLE,
     POLYGON,
-    BOX
+    BOX,
+    CAPSULE,
+    CHAIN,
+    COUNT // Number of shape types, keep last
+};
+
+// Result of a ray cast against a shape, the hit point is start + (end - start) * fraction
+struct RayCastOutput {
+    Vec2 normal{};          // Surface normal at the hit point
+    float fraction = 0.0f;
 };
 
 struct Shape {
@@ -18,6 +29,25 @@ struct Shape {
     virtual Shape *Clone() const = 0;
 	virtual void UpdateVertices(float angle, const Vec2& position) = 0;
     virtual float GetMomentOfInertia() const = 0;
+
+    // Farthest point of the shape core along the direction, in world space (used by GJK/EPA)
+    virtual Vec2 GetSupportPoint(const Vec2& direction) const = 0;
+
+    // Radius rounding the shape core, the surface is the core inflated by this radius
+    virtual float GetRadius() const { return 0.0f; }
+
+    // World space bounding box, valid after UpdateVertices
+    virtual AABB GetAABB() const = 0;
+
+    // Exact intersection of the ray start -> end with the shape surface within maxFraction.
+    // Rays starting inside the shape don't hit it.
+    virtual bool RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const = 0;
+
+    // RayCast for the rays of a BVH packet whose bit is set in laneMask, returns the mask of the rays that hit
+    virtual int RayCastPacket(const Vec2* starts, const Vec2* ends, const float* maxFractions, int laneMask, RayCastOutput* outputs) const;
+
+    // Whether the world space point is inside the shape or on its surface
+    virtual bool TestPoint(const Vec2& point) const = 0;
 };
 
 struct CircleShape : public Shape {
@@ -28,14 +58,26 @@ struct CircleShape : public Shape {
     Shape *Clone() const override { return new CircleShape(*this); }
 	void UpdateVertices(float angle, const Vec2& position) override;
     float GetMomentOfInertia() const override;
+    Vec2 GetSupportPoint(const Vec2& direction) const override { return center; }
+    float GetRadius() const override { return radius; }
+    AABB GetAABB() const override;
+    bool RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const override;
+    int RayCastPacket(const Vec2* starts, const Vec2* ends, const float* maxFractions, int laneMask, RayCastOutput* outputs) const override;
+    bool TestPoint(const Vec2& point) const override;
 
     float radius;
+
+    // World space center, the core of the circle is this single point
+    Vec2 center{};
 };
 
 struct PolygonShape : public Shape {
     std::vector<Vec2> localVertices;
     std::vector<Vec2> worldVertices;
 
+    // Radius of the circle around the local origin that encloses all vertices
+    float boundingRadius = 0.0f;
+
     PolygonShape(const std::vector<Vec2> &vertices);
     virtual ~PolygonShape() = default;
 
@@ -49,14 +91,22 @@ struct PolygonShape : public Shape {
     // Get the perpendicular of the edge
     Vec2 GetNormal(int index) const;
 
-    // Get minimum sepration between polygons
-    float FindMinSeparation(const PolygonShape& other, int &outIndexReferenceEdge, Vec2& outSupportPoint) const;
+    Vec2 GetSupportPoint(const Vec2& direction) const override;
+    AABB GetAABB() const override;
+    bool RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const override;
+    bool TestPoint(const Vec2& point) const override;
+
+    // Find the vertex farthest along the direction, hill climbing the convex vertex ring from startIndex
+    int FindSupportIndex(const Vec2& direction, int startIndex = 0) const;
+
+    // Get minimum sepration between polygons, inOutSupportIndex is where the support search on "other" starts
+    float FindMinSeparation(const PolygonShape& other, int &outIndexReferenceEdge, Vec2& outSupportPoint, int &inOutSupportIndex) const;
 
     // Function to rotate and translate the polygon vertices from "local space" to "world space."
     void UpdateVertices(float angle, const Vec2& position) override;
 
-    // Find the incident edge of the polygon based on the reference edge normal
-    int FindIncidentEdge(const Vec2 &normal) const;
+    // Find the incident edge of the polygon based on the reference edge normal, hill climbing from startIndex
+    int FindIncidentEdge(const Vec2 &normal, int startIndex = 0) const;
 
     // Clip the polygon against the edge
     int ClipSegmentToLine(const std::vector<Vec2>& contactsIn, std::vector<Vec2>& contactsOut, const Vec2& c0, const Vec2& c1) const;
@@ -65,12 +115,110 @@ struct PolygonShape : public Shape {
 struct BoxShape : public PolygonShape {
     float width, height;
 
+    // Rotation and center cached by UpdateVertices, used by the box-vs-box narrowphase
+    Vec2 center{};
+    Vec2 axisX{1.0f, 0.0f};
+    Vec2 axisY{0.0f, 1.0f};
+
     BoxShape(float width, float height);
     virtual ~BoxShape() = default;
 
     ShapeType GetType() const override { return ShapeType::BOX; }
     Shape *Clone() const override { return new BoxShape(*this); }
     float GetMomentOfInertia() const override;
+
+    // Transform the four corners using the cached rotation axes
+    void UpdateVertices(float angle, const Vec2& position) override;
+
+    // Get the outward normal of the edge "index" from the cached axes (same as GetNormal)
+    Vec2 GetFaceNormal(int index) const;
+
+    // Get minimum separation between boxes testing only the 4 face axes of this box
+    using PolygonShape::FindMinSeparation;
+    float FindMinSeparation(const BoxShape& other, int &outIndexReferenceEdge) const;
+
+    // Find the incident edge of the box based on the reference edge normal
+    int FindIncidentEdge(const Vec2 &normal) const;
+
+    // Slab test in the box frame
+    bool RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const override;
+    bool TestPoint(const Vec2& point) const override;
+};
+
+////////////////////////////////////////////////////////////
+// Vertical capsule: a segment of the given length between
+// the two cap centers, inflated by the radius
+////////////////////////////////////////////////////////////
+struct CapsuleShape : public Shape {
+    float length, radius;
+
+    // Cap centers in world space, updated by UpdateVertices
+    Vec2 worldPoint1{};
+    Vec2 worldPoint2{};
+
+    CapsuleShape(float length, float radius);
+    virtual ~CapsuleShape() = default;
+
+    ShapeType GetType() const override { return ShapeType::CAPSULE; }
+    Shape *Clone() const override { return new CapsuleShape(*this); }
+    void UpdateVertices(float angle, const Vec2& position) override;
+    float GetMomentOfInertia() const override;
+    Vec2 GetSupportPoint(const Vec2& direction) const override;
+    float GetRadius() const override { return radius; }
+    AABB GetAABB() const override;
+    bool RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const override;
+    bool TestPoint(const Vec2& point) const override;
+
+    // Radius of the circle around the center that encloses the whole capsule
+    float GetBoundingRadius() const { return length * 0.5f + radius; }
+};
+
+// Segment of a chain with its neighbour (ghost) vertices: v0 -> [v1 -> v2] -> v3
+struct ChainSegment {
+    Vec2 v0, v1, v2, v3;
+    Vec2 normal;            // Collision side of the segment
+    bool hasPrevious;       // False for the first segment of an open chain
+    bool hasNext;           // False for the last segment of an open chain
+    bool isConvex1;         // The chain bends away from the normal at v1
+    bool isConvex2;         // The chain bends away from the normal at v2
+};
+
+////////////////////////////////////////////////////////////
+// Static chain of segments for level geometry. Segments are
+// one-sided, they collide on the side of GetNormal (the
+// outward side of a polygon with the same winding). The
+// segments are kept in a BVH so a query only visits the
+// ones near the other shape.
+////////////////////////////////////////////////////////////
+struct ChainShape : public Shape {
+    std::vector<Vec2> localVertices;
+    std::vector<Vec2> worldVertices;
+    bool isLoop;
+
+    // Segment bounding boxes in world space, rebuilt by UpdateVertices
+    BVH tree;
+
+    ChainShape(const std::vector<Vec2> &vertices, bool isLoop = true);
+    virtual ~ChainShape() = default;
+
+    ShapeType GetType() const override { return ShapeType::CHAIN; }
+    Shape *Clone() const override { return new ChainShape(*this); }
+    void UpdateVertices(float angle, const Vec2& position) override;
+    float GetMomentOfInertia() const override;
+    Vec2 GetSupportPoint(const Vec2& direction) const override;
+    AABB GetAABB() const override;
+
+    // Closest front side hit among the segments, found through the segment tree
+    bool RayCast(const Vec2& start, const Vec2& end, float maxFraction, RayCastOutput& output) const override;
+
+    // Segments have no inside, nothing is ever contained
+    bool TestPoint(const Vec2& point) const override { return false; }
+
+    int GetSegmentCount() const;
+    ChainSegment GetSegment(int index) const;
+
+    // Segment as a zero radius capsule, for the GJK based queries
+    CapsuleShape GetSegmentShape(int index) const;
 };
 
 #endif
@@ -0,0 +1,225 @@
+#include "SoftBodySystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "./Body.h"
+#include "./World.h"
+
+int SoftBodySystem::AddParticle(const Vec2 &position, float mass, float radius) {
+    x.push_back(position.x);
+    y.push_back(position.y);
+    vx.push_back(0.0f);
+    vy.push_back(0.0f);
+    inverseMasses.push_back(mass > 0.0f ? 1.0f / mass : 0.0f);
+    radii.push_back(radius);
+    return GetParticleCount() - 1;
+}
+
+int SoftBodySystem::AddDistanceConstraint(int a, int b, float compliance, float restLength) {
+    if (restLength < 0.0f)
+        restLength = (GetPosition(b) - GetPosition(a)).Magnitude();
+
+    distanceA.push_back(a);
+    distanceB.push_back(b);
+    distanceRestLengths.push_back(restLength);
+    distanceCompliances.push_back(compliance);
+    return GetDistanceConstraintCount() - 1;
+}
+
+int SoftBodySystem::AddAreaConstraint(const std::vector<int> &loop, float compliance, float pressure) {
+    areaFirst.push_back(static_cast<int>(loopIndices.size()));
+    areaCounts.push_back(static_cast<int>(loop.size()));
+    loopIndices.insert(loopIndices.end(), loop.begin(), loop.end());
+
+    const int area = static_cast<int>(areaFirst.size()) - 1;
+    areaRests.push_back(GetLoopArea(area) * pressure);
+    areaCompliances.push_back(compliance);
+    return area;
+}
+
+int SoftBodySystem::AddRope(const Vec2 &start, const Vec2 &end, int segmentCount, float particleMass, float particleRadius, float compliance, bool isStartPinned) {
+    const int first = GetParticleCount();
+    for (int i = 0; i <= segmentCount; i++) {
+        const float mass = (i == 0 && isStartPinned) ? 0.0f : particleMass;
+        AddParticle(start + (end - start) * (static_cast<float>(i) / segmentCount), mass, particleRadius);
+        if (i > 0)
+            AddDistanceConstraint(first + i - 1, first + i, compliance);
+    }
+    return first;
+}
+
+int SoftBodySystem::AddBlob(const Vec2 &center, float radius, int particleCount, float particleMass, float particleRadius, float edgeCompliance, float areaCompliance) {
+    const float pi = 3.14159265f;
+    const int first = GetParticleCount();
+    std::vector<int> loop;
+    for (int i = 0; i < particleCount; i++) {
+        const float angle = 2.0f * pi * i / particleCount;
+        loop.push_back(AddParticle(center + Vec2(std::cos(angle), std::sin(angle)) * radius, particleMass, particleRadius));
+    }
+    for (int i = 0; i < particleCount; i++)
+        AddDistanceConstraint(first + i, first + (i + 1) % particleCount, edgeCompliance);
+    AddAreaConstraint(loop, areaCompliance);
+    return first;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Signed area of a loop (shoelace formula), A = 1/2 Σ (xi yi+1 - xi+1 yi)
+///////////////////////////////////////////////////////////////////////////////
+float SoftBodySystem::GetLoopArea(int area) const {
+    const int* loop = loopIndices.data() + areaFirst[area];
+    const int count = areaCounts[area];
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) {
+        const int p = loop[i];
+        const int q = loop[(i + 1) % count];
+        sum += x[p] * y[q] - x[q] * y[p];
+    }
+    return 0.5f * sum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// One broadphase query per particle covers every substep: the box spans
+// the particle now and where its velocity takes it by the end of the step.
+///////////////////////////////////////////////////////////////////////////////
+void SoftBodySystem::FindCandidates(float deltaTime, World &world) {
+    const int count = GetParticleCount();
+    candidates.clear();
+    candidateFirst.resize(count + 1);
+    for (int i = 0; i < count; i++) {
+        candidateFirst[i] = static_cast<int>(candidates.size());
+        if (inverseMasses[i] == 0.0f) continue;
+
+        const Vec2 position(x[i], y[i]);
+        const Vec2 predicted = position + Vec2(vx[i], vy[i]) * deltaTime;
+        const Vec2 reach(radii[i] * 2.0f, radii[i] * 2.0f);
+        const AABB box(Vec2(std::min(position.x, predicted.x), std::min(position.y, predicted.y)) - reach,
+                       Vec2(std::max(position.x, predicted.x), std::max(position.y, predicted.y)) + reach);
+        collider.QueryBodies(world, box, candidates);
+    }
+    candidateFirst[count] = static_cast<int>(candidates.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// C = |xa - xb| - rest, Δλ = (-C - α̃λ) / (wa + wb + α̃) with α̃ = α / h².
+// A single pass per substep, so λ starts from zero each time
+///////////////////////////////////////////////////////////////////////////////
+void SoftBodySystem::SolveDistances(float inverseSubstepSquared) {
+    const int count = GetDistanceConstraintCount();
+    for (int c = 0; c < count; c++) {
+        const int a = distanceA[c];
+        const int b = distanceB[c];
+        const float wSum = inverseMasses[a] + inverseMasses[b];
+        if (wSum == 0.0f) continue;
+
+        const float dx = x[a] - x[b];
+        const float dy = y[a] - y[b];
+        const float length = std::sqrt(dx * dx + dy * dy);
+        if (length <= 0.0f) continue;
+
+        const float alpha = distanceCompliances[c] * inverseSubstepSquared;
+        const float lambda = -(length - distanceRestLengths[c]) / (wSum + alpha) / length;
+        x[a] += dx * lambda * inverseMasses[a];
+        y[a] += dy * lambda * inverseMasses[a];
+        x[b] -= dx * lambda * inverseMasses[b];
+        y[b] -= dy * lambda * inverseMasses[b];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// C = A - rest, the gradient for particle i is 1/2 (yi+1 - yi-1, xi-1 - xi+1)
+///////////////////////////////////////////////////////////////////////////////
+void SoftBodySystem::SolveAreas(float inverseSubstepSquared) {
+    const int areaCount = static_cast<int>(areaFirst.size());
+    for (int area = 0; area < areaCount; area++) {
+        const int* loop = loopIndices.data() + areaFirst[area];
+        const int count = areaCounts[area];
+
+        float denominator = areaCompliances[area] * inverseSubstepSquared;
+        for (int i = 0; i < count; i++) {
+            const int next = loop[(i + 1) % count];
+            const int previous = loop[(i + count - 1) % count];
+            const float gx = 0.5f * (y[next] - y[previous]);
+            const float gy = 0.5f * (x[previous] - x[next]);
+            denominator += inverseMasses[loop[i]] * (gx * gx + gy * gy);
+        }
+        if (denominator <= 0.0f) continue;
+
+        const float lambda = -(GetLoopArea(area) - areaRests[area]) / denominator;
+
+        // Gradients from the positions before this constraint moved anything
+        float previousX = x[loop[count - 1]], previousY = y[loop[count - 1]];
+        const float firstX = x[loop[0]], firstY = y[loop[0]];
+        for (int i = 0; i < count; i++) {
+            const int p = loop[i];
+            const float nextX = i + 1 < count ? x[loop[i + 1]] : firstX;
+            const float nextY = i + 1 < count ? y[loop[i + 1]] : firstY;
+            const float gx = 0.5f * (nextY - previousY);
+            const float gy = 0.5f * (previousX - nextX);
+            previousX = x[p];
+            previousY = y[p];
+            x[p] += lambda * inverseMasses[p] * gx;
+            y[p] += lambda * inverseMasses[p] * gy;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The probe circle is moved onto the particle and run through the
+// narrowphase against its candidates. The particle leaves along the
+// deepest contact and loses part of its sliding motion over the substep.
+///////////////////////////////////////////////////////////////////////////////
+void SoftBodySystem::SolveCollisions() {
+    const int count = GetParticleCount();
+    for (int i = 0; i < count; i++) {
+        if (candidateFirst[i] == candidateFirst[i + 1]) continue;
+
+        for (int c = candidateFirst[i]; c < candidateFirst[i + 1]; c++) {
+            Contact contact;
+            if (!collider.GetDeepestContact(candidates[c], Vec2(x[i], y[i]), radii[i], contact)) continue;
+
+            Vec2 normal = contact.normal;
+            x[i] += normal.x * contact.depth;
+            y[i] += normal.y * contact.depth;
+
+            // Friction on the motion along the surface since the substep began
+            const Vec2 motion(x[i] - previousX[i], y[i] - previousY[i]);
+            const Vec2 sliding = motion - normal * motion.Dot(normal);
+            x[i] -= sliding.x * friction;
+            y[i] -= sliding.y * friction;
+        }
+    }
+}
+
+void SoftBodySystem::Step(float deltaTime, const Vec2 &gravity, World &world) {
+    const int count = GetParticleCount();
+    if (count == 0 || deltaTime <= 0.0f || substeps <= 0) return;
+
+    FindCandidates(deltaTime, world);
+    previousX.resize(count);
+    previousY.resize(count);
+
+    const float h = deltaTime / substeps;
+    const float inverseSubstepSquared = 1.0f / (h * h);
+    for (int substep = 0; substep < substeps; substep++) {
+        for (int i = 0; i < count; i++) {
+            previousX[i] = x[i];
+            previousY[i] = y[i];
+            if (inverseMasses[i] == 0.0f) continue;
+
+            vx[i] += gravity.x * h;
+            vy[i] += gravity.y * h;
+            x[i] += vx[i] * h;
+            y[i] += vy[i] * h;
+        }
+
+        SolveDistances(inverseSubstepSquared);
+        SolveAreas(inverseSubstepSquared);
+        SolveCollisions();
+
+        for (int i = 0; i < count; i++) {
+            vx[i] = (x[i] - previousX[i]) / h;
+            vy[i] = (y[i] - previousY[i]) / h;
+        }
+    }
+}
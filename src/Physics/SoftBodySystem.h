@@ -0,0 +1,97 @@
+#ifndef SOFTBODYSYSTEM_H
+#define SOFTBODYSYSTEM_H
+
+#pragma once
+
+#include <vector>
+
+#include "Math/Vec2.h"
+#include "ParticleCollider.h"
+
+// Forward declaration
+struct Body;
+class World;
+
+////////////////////////////////////////////////////////////
+// Position based particles for ropes, jelly and banners
+// (XPBD, Macklin et al. "Small Steps in Physics Simulation").
+// Particles are linked by distance constraints and closed
+// loops of them keep their area, both with a compliance
+// (inverse stiffness, zero is rigid). The world steps the
+// system after the bodies in substeps, particles are pushed
+// out of the bodies but don't push them back.
+////////////////////////////////////////////////////////////
+class SoftBodySystem
+{
+public:
+    SoftBodySystem() = default;
+
+    SoftBodySystem(const SoftBodySystem&) = delete;
+    SoftBodySystem& operator=(const SoftBodySystem&) = delete;
+
+    // Substeps per world step, each one runs a single pass over the constraints
+    int substeps = 8;
+
+    // Share of the sliding motion removed while a particle touches a body
+    float friction = 0.5f;
+
+    // Filter of the particles against the world bodies and their narrowphase
+    ParticleCollider collider;
+
+    // Particles, one entry per particle in every array. A zero inverse mass pins the particle
+    std::vector<float> x, y;
+    std::vector<float> vx, vy;
+    std::vector<float> inverseMasses;
+    std::vector<float> radii;
+
+    // Returns the index of the particle, a zero mass pins it in place
+    int AddParticle(const Vec2& position, float mass, float radius);
+
+    // Distance between particles a and b, a negative rest length takes their current distance
+    int AddDistanceConstraint(int a, int b, float compliance = 0.0f, float restLength = -1.0f);
+
+    // Area of the closed loop through the particles, the rest area is the current one scaled by pressure
+    int AddAreaConstraint(const std::vector<int>& loop, float compliance = 0.0f, float pressure = 1.0f);
+
+    // Chain of segmentCount + 1 particles from start to end, the first one pinned if isStartPinned. Returns the first index
+    int AddRope(const Vec2& start, const Vec2& end, int segmentCount, float particleMass, float particleRadius, float compliance = 0.0f, bool isStartPinned = true);
+
+    // Ring of particles around center linked by its edges and keeping its area. Returns the first index
+    int AddBlob(const Vec2& center, float radius, int particleCount, float particleMass, float particleRadius, float edgeCompliance = 0.0f, float areaCompliance = 0.0f);
+
+    inline int GetParticleCount() const { return static_cast<int>(x.size()); }
+    inline int GetDistanceConstraintCount() const { return static_cast<int>(distanceA.size()); }
+    inline Vec2 GetPosition(int particle) const { return Vec2(x[particle], y[particle]); }
+    inline void GetDistanceConstraint(int constraint, int& outA, int& outB) const { outA = distanceA[constraint]; outB = distanceB[constraint]; }
+
+    // Advance the particles by deltaTime under gravity (pixels / s²), colliding with the bodies of the world
+    void Step(float deltaTime, const Vec2& gravity, World& world);
+
+private:
+    std::vector<float> previousX, previousY;
+
+    // Distance constraints
+    std::vector<int> distanceA, distanceB;
+    std::vector<float> distanceRestLengths;
+    std::vector<float> distanceCompliances;
+
+    // Area constraints, each one a range of loopIndices
+    std::vector<int> loopIndices;
+    std::vector<int> areaFirst, areaCounts;
+    std::vector<float> areaRests;
+    std::vector<float> areaCompliances;
+
+    // Bodies the broadphase found around each particle for the whole step, particle i owns
+    // candidates[candidateFirst[i] .. candidateFirst[i + 1]]
+    std::vector<Body*> candidates;
+    std::vector<int> candidateFirst;
+
+
+    float GetLoopArea(int area) const;
+    void FindCandidates(float deltaTime, World& world);
+    void SolveDistances(float inverseSubstepSquared);
+    void SolveAreas(float inverseSubstepSquared);
+    void SolveCollisions();
+};
+
+#endif
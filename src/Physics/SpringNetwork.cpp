@@ -0,0 +1,137 @@
+#include "SpringNetwork.h"
+
+#include <cmath>
+
+#include "./Body.h"
+
+SpringNetwork::SpringNetwork(SpringIntegration integration) : integration(integration) {
+}
+
+int SpringNetwork::AddBody(Body *body) {
+    bodies.push_back(body);
+    return static_cast<int>(bodies.size()) - 1;
+}
+
+int SpringNetwork::AddSpring(int a, int b, float stiffness, float damping, float restLength) {
+    if (restLength < 0.0f)
+        restLength = (bodies[b]->position - bodies[a]->position).Magnitude();
+
+    indexA.push_back(a);
+    indexB.push_back(b);
+    restLengths.push_back(restLength);
+    stiffnesses.push_back(stiffness);
+    dampings.push_back(damping);
+    return static_cast<int>(indexA.size()) - 1;
+}
+
+void SpringNetwork::GatherBodies() {
+    const int count = static_cast<int>(bodies.size());
+    x.resize(count);
+    y.resize(count);
+    vx.resize(count);
+    vy.resize(count);
+    inverseMasses.resize(count);
+    for (int i = 0; i < count; i++) {
+        x[i] = bodies[i]->position.x;
+        y[i] = bodies[i]->position.y;
+        vx[i] = bodies[i]->velocity.x;
+        vy[i] = bodies[i]->velocity.y;
+        inverseMasses[i] = bodies[i]->inverseMass;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Hooke's law with damping along the spring, F = -(k * stretch + c * speed) * n
+// on body a, computed for every spring in one pass then added to the bodies
+///////////////////////////////////////////////////////////////////////////////
+void SpringNetwork::ApplyForces() {
+    if (integration != SpringIntegration::EXPLICIT) return;
+    GatherBodies();
+
+    const int springCount = GetSpringCount();
+    forceX.resize(springCount);
+    forceY.resize(springCount);
+    for (int s = 0; s < springCount; s++) {
+        forceX[s] = forceY[s] = 0.0f;
+        if (stiffnesses[s] <= 0.0f) continue;
+
+        const int a = indexA[s];
+        const int b = indexB[s];
+        const float dx = x[a] - x[b];
+        const float dy = y[a] - y[b];
+        const float length = std::sqrt(dx * dx + dy * dy);
+        const float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+        const float speed = ((vx[a] - vx[b]) * dx + (vy[a] - vy[b]) * dy) * inverseLength;
+        const float magnitude = -(stiffnesses[s] * (length - restLengths[s]) + dampings[s] * speed) * inverseLength;
+        forceX[s] = dx * magnitude;
+        forceY[s] = dy * magnitude;
+    }
+
+    for (int s = 0; s < springCount; s++) {
+        Vec2 force(forceX[s], forceY[s]);
+        bodies[indexA[s]]->AddForce(force);
+        bodies[indexB[s]]->AddForce(-force);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// XPBD distance constraints, C = |xa - xb| - rest, with compliance 1 / k, so
+// a zero stiffness is an infinitely soft spring and is skipped like in ApplyForces
+// (Macklin et al., "XPBD: Position-Based Simulation of Compliant Constrained
+// Dynamics"). Each pass moves the bodies along the springs by
+//   Δλ = (-C - α̃λ - γ ∇C·(x - x0)) / ((1 + γ)(wa + wb) + α̃)
+// with α̃ = 1 / (k Δt²) and γ = α̃ c Δt. The displacement since the start of
+// the solve is added to the velocities divided by Δt.
+///////////////////////////////////////////////////////////////////////////////
+void SpringNetwork::SolvePositions(float deltaTime) {
+    if (integration != SpringIntegration::XPBD || deltaTime <= 0.0f) return;
+    GatherBodies();
+
+    // Bodies are already integrated, so x0 = x - v Δt is where they started the step
+    const int springCount = GetSpringCount();
+    const int count = static_cast<int>(bodies.size());
+    std::vector<float> startX(x), startY(y);
+    lambdas.assign(springCount, 0.0f);
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        for (int s = 0; s < springCount; s++) {
+            const int a = indexA[s];
+            const int b = indexB[s];
+            const float wSum = inverseMasses[a] + inverseMasses[b];
+            if (wSum <= 0.0f || stiffnesses[s] <= 0.0f) continue;
+
+            const float dx = x[a] - x[b];
+            const float dy = y[a] - y[b];
+            const float length = std::sqrt(dx * dx + dy * dy);
+            if (length <= 0.0f) continue;
+            const float nx = dx / length;
+            const float ny = dy / length;
+
+            const float alpha = 1.0f / (stiffnesses[s] * deltaTime * deltaTime);
+            const float gamma = alpha * dampings[s] * deltaTime;
+
+            // Relative motion along the spring since the start of the step
+            const float motion = nx * ((x[a] - startX[a] + vx[a] * deltaTime) - (x[b] - startX[b] + vx[b] * deltaTime)) +
+                                 ny * ((y[a] - startY[a] + vy[a] * deltaTime) - (y[b] - startY[b] + vy[b] * deltaTime));
+
+            const float C = length - restLengths[s];
+            const float deltaLambda = (-C - alpha * lambdas[s] - gamma * motion) / ((1.0f + gamma) * wSum + alpha);
+            lambdas[s] += deltaLambda;
+
+            x[a] += nx * deltaLambda * inverseMasses[a];
+            y[a] += ny * deltaLambda * inverseMasses[a];
+            x[b] -= nx * deltaLambda * inverseMasses[b];
+            y[b] -= ny * deltaLambda * inverseMasses[b];
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        Body *body = bodies[i];
+        if (body->IsStatic()) continue;
+
+        const Vec2 correction(x[i] - startX[i], y[i] - startY[i]);
+        body->position += correction;
+        body->velocity += correction / deltaTime;
+        body->shape->UpdateVertices(body->rotation, body->position);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef SPRINGNETWORK_H
+#define SPRINGNETWORK_H
+
+#pragma once
+
+#include <vector>
+
+// Forward declaration
+struct Body;
+
+enum class SpringIntegration {
+    EXPLICIT,   // Spring forces added before the velocities are integrated, stiff springs need small steps
+    XPBD,       // Distance constraints projected on the positions with a compliance, stable at any stiffness
+};
+
+////////////////////////////////////////////////////////////
+// Springs between the centers of a set of bodies, for cloth
+// and soft body meshes. Springs are index pairs into the
+// body list of the network and are all evaluated in one
+// batch. Static bodies pin the springs attached to them.
+// The springs don't stop the bodies from colliding with each
+// other, give them a shared negative group for that.
+////////////////////////////////////////////////////////////
+class SpringNetwork
+{
+public:
+    SpringNetwork(SpringIntegration integration = SpringIntegration::XPBD);
+
+    // Returns the index of the body in the network
+    int AddBody(Body* body);
+
+    // Spring between bodies a and b of the network, a negative rest length takes their current distance.
+    // Damping works against the relative velocity along the spring. The stiffness means the same in both
+    // modes: XPBD uses the compliance 1 / stiffness, and a stiffness of 0 or less makes the spring inactive
+    // (no force, no damping), it is never a rigid rod. Use a large stiffness or a SoftBodySystem distance
+    // constraint with compliance 0 for that. Returns the index of the spring
+    int AddSpring(int a, int b, float stiffness, float damping = 0.0f, float restLength = -1.0f);
+
+    inline const std::vector<Body*>& GetBodies() const { return bodies; }
+    inline int GetSpringCount() const { return static_cast<int>(indexA.size()); }
+    inline SpringIntegration GetIntegration() const { return integration; }
+
+    // Projection passes over all the springs per step in XPBD mode
+    int iterations = 10;
+
+    // EXPLICIT: add the spring forces to the bodies
+    void ApplyForces();
+
+    // XPBD: move the integrated bodies to satisfy the springs, their velocities take the correction
+    void SolvePositions(float deltaTime);
+
+private:
+    SpringIntegration integration;
+    std::vector<Body*> bodies;
+
+    // Springs, one entry per spring in every array
+    std::vector<int> indexA;
+    std::vector<int> indexB;
+    std::vector<float> restLengths;
+    std::vector<float> stiffnesses;
+    std::vector<float> dampings;
+
+    // Scratch arrays of the batch, per body then per spring
+    std::vector<float> x, y, vx, vy, inverseMasses;
+    std::vector<float> forceX, forceY, lambdas;
+
+    void GatherBodies();
+};
+
+#endif
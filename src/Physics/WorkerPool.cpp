@@ -0,0 +1,64 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker: workers)
+        worker.join();
+}
+
+void WorkerPool::ParallelFor(int count, int threadCount, const std::function<void(int, int)>& function) {
+    const int chunks = std::max(1, std::min(threadCount, count));
+    if (chunks == 1) {
+        function(0, count);
+        return;
+    }
+
+    // New workers wait for the loop posted next, not the ones already done
+    while (static_cast<int>(workers.size()) < chunks - 1)
+        workers.emplace_back(&WorkerPool::Run, this, static_cast<int>(workers.size()), generation);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &function;
+        taskCount = count;
+        chunkCount = chunks;
+        pending = chunks - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    function(count * (chunks - 1) / chunks, count);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return pending == 0; });
+    task = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A worker outside the chunks of a loop skips it. One inside can't miss
+// a loop, the caller waits for it before posting the next one.
+///////////////////////////////////////////////////////////////////////////////
+void WorkerPool::Run(int index, unsigned int seen) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&]() { return isStopping || generation != seen; });
+        if (isStopping) return;
+        seen = generation;
+        if (index >= chunkCount - 1) continue;
+
+        const std::function<void(int, int)>* function = task;
+        const int first = taskCount * index / chunkCount;
+        const int last = taskCount * (index + 1) / chunkCount;
+        lock.unlock();
+        (*function)(first, last);
+        lock.lock();
+
+        if (--pending == 0) done.notify_one();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////
+// Threads kept alive between parallel loops, so a loop costs
+// waking them up rather than starting and joining new ones.
+// Workers are started the first time a loop needs them and
+// stopped with the pool.
+////////////////////////////////////////////////////////////
+class WorkerPool
+{
+public:
+    WorkerPool() = default;
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Splits [0, count) into threadCount contiguous chunks, function(first, last) runs once per chunk.
+    // The calling thread takes the last one and returns when all of them are done
+    void ParallelFor(int count, int threadCount, const std::function<void(int, int)>& function);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    // Loop being run, worker i takes chunk i while i < chunkCount - 1
+    const std::function<void(int, int)>* task = nullptr;
+    int taskCount = 0;
+    int chunkCount = 0;
+    unsigned int generation = 0;
+    int pending = 0;
+    bool isStopping = false;
+
+    // Runs the chunks of the loops posted after the generation seen
+    void Run(int index, unsigned int seen);
+};
+
+#endif
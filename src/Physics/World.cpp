@@ -4,6 +4,8 @@
 #include "CollisionDetection.h"
 
 #include <algorithm>
+#include <cmath>
+#include <thread>
 
 World::World(float gravity) : G(-gravity)
 {
@@ -11,17 +13,62 @@ World::World(float gravity) : G(-gravity)
 
 World::~World()
 {
+	// The narrowphase cache outlives the world, its bodies must not stay in it
+	CollisionDetection::ClearCache(bodies);
 	for (auto &body: bodies) {
 		delete body;
 	}
     for (auto &constraint: constraints) {
         delete constraint;
     }
+    for (auto &field: forceFields) {
+        delete field;
+    }
+    for (auto &network: springNetworks) {
+        delete network;
+    }
+    for (auto &system: softBodySystems) {
+        delete system;
+    }
+    for (auto &system: fluidSystems) {
+        delete system;
+    }
+    for (auto &system: debrisSystems) {
+        delete system;
+    }
 }
 
 void World::AddBody(Body *body)
 {
 	bodies.push_back(body);
+
+	if (body->IsStatic()) {
+		body->proxyIndex = static_cast<int>(staticBodies.size());
+		staticBodies.push_back(body);
+		isStaticTreeDirty = true;
+
+		// Dynamic bodies only look for static partners when their proxies move, the ones around the new body look again
+		const AABB box = body->shape->GetAABB();
+		if (isDynamicTreeDirty) {
+			for (Proxy& proxy: proxies)
+				if (proxy.box.Overlaps(box)) proxy.isMoved = true;
+		} else {
+			dynamicTree.Query(box, [&](int index) {
+				proxies[index].isMoved = true;
+				return true;
+			});
+		}
+	} else {
+		body->proxyIndex = static_cast<int>(dynamicBodies.size());
+		dynamicBodies.push_back(body);
+
+		const AABB box = body->shape->GetAABB();
+		Proxy proxy;
+		proxy.box = AABB(box.min - Vec2(PROXY_MARGIN, PROXY_MARGIN), box.max + Vec2(PROXY_MARGIN, PROXY_MARGIN));
+		proxy.sweptBox = box;
+		proxies.push_back(proxy);
+		isDynamicTreeDirty = true;
+	}
 }
 
 void World::RemoveBody(Body *body)
@@ -29,12 +76,49 @@ void World::RemoveBody(Body *body)
 	auto it = std::find(bodies.begin(), bodies.end(), body);
 	if (it != bodies.end()) {
 		bodies.erase(it);
+		CollisionDetection::ClearCache(body);
+
+		for (int i = static_cast<int>(pairs.size()) - 1; i >= 0; i--) {
+			if (pairs[i].a == body || pairs[i].b == body)
+				RemovePair(i, false);
+		}
+
+		// Its joints no longer keep anything from colliding, removing them later finds nothing to undo
+		for (auto connectedIt = connectedPairs.begin(); connectedIt != connectedPairs.end();) {
+			if (connectedIt->first.first == body || connectedIt->first.second == body)
+				connectedIt = connectedPairs.erase(connectedIt);
+			else
+				++connectedIt;
+		}
+
+		// The last body of the list takes the place of the removed one
+		const int index = body->proxyIndex;
+		std::vector<Body*>& list = body->IsStatic() ? staticBodies : dynamicBodies;
+		list[index] = list.back();
+		list[index]->proxyIndex = index;
+		list.pop_back();
+		body->proxyIndex = -1;
+
+		if (body->IsStatic()) {
+			isStaticTreeDirty = true;
+		} else {
+			proxies[index] = proxies.back();
+			proxies.pop_back();
+			isDynamicTreeDirty = true;
+		}
 	}
 }
 
 void World::AddConstraint(Constraint *constraint)
 {
     constraints.push_back(constraint);
+
+    // The connected bodies stop colliding on the next update
+    const BodyPair key = MakeBodyPair(constraint->a, constraint->b);
+    connectedPairs[key]++;
+    auto pairIt = pairIndices.find(key);
+    if (pairIt != pairIndices.end())
+        pairs[pairIt->second].isFilterStale = true;
 }
 
 void World::RemoveConstraint(Constraint *constraint)
@@ -42,17 +126,133 @@ void World::RemoveConstraint(Constraint *constraint)
     auto it = std::find(constraints.begin(), constraints.end(), constraint);
     if (it != constraints.end()) {
         constraints.erase(it);
+
+        // Once nothing connects them anymore the bodies can collide again
+        auto connectedIt = connectedPairs.find(MakeBodyPair(constraint->a, constraint->b));
+        if (connectedIt != connectedPairs.end() && --connectedIt->second == 0) {
+            connectedPairs.erase(connectedIt);
+            TouchProxy(constraint->a);
+            TouchProxy(constraint->b);
+        }
+    }
+}
+
+void World::Refilter(Body *body)
+{
+    // Existing pairs are checked again, new ones are searched for
+    for (ContactPair &pair: pairs) {
+        if (pair.a == body || pair.b == body)
+            pair.isFilterStale = true;
     }
+    TouchProxy(body);
 }
 
 void World::AddForce(const Vec2 &force)
 {
-	forces.push_back(force);
+	globalForces.force += force;
 }
 
 void World::AddTorque(float torque)
 {
-	torques.push_back(torque);
+	globalForces.torque += torque;
+}
+
+void World::AddForceField(ForceField *field)
+{
+	forceFields.push_back(field);
+}
+
+void World::RemoveForceField(ForceField *field)
+{
+	auto it = std::find(forceFields.begin(), forceFields.end(), field);
+	if (it != forceFields.end())
+		forceFields.erase(it);
+}
+
+void World::AddSpringNetwork(SpringNetwork *network)
+{
+	springNetworks.push_back(network);
+}
+
+void World::RemoveSpringNetwork(SpringNetwork *network)
+{
+	auto it = std::find(springNetworks.begin(), springNetworks.end(), network);
+	if (it != springNetworks.end())
+		springNetworks.erase(it);
+}
+
+void World::AddSoftBodySystem(SoftBodySystem *system)
+{
+	softBodySystems.push_back(system);
+}
+
+void World::RemoveSoftBodySystem(SoftBodySystem *system)
+{
+	auto it = std::find(softBodySystems.begin(), softBodySystems.end(), system);
+	if (it != softBodySystems.end())
+		softBodySystems.erase(it);
+}
+
+void World::AddFluidSystem(FluidSystem *system)
+{
+	fluidSystems.push_back(system);
+}
+
+void World::RemoveFluidSystem(FluidSystem *system)
+{
+	auto it = std::find(fluidSystems.begin(), fluidSystems.end(), system);
+	if (it != fluidSystems.end())
+		fluidSystems.erase(it);
+}
+
+void World::AddDebrisSystem(DebrisSystem *system)
+{
+	debrisSystems.push_back(system);
+}
+
+void World::RemoveDebrisSystem(DebrisSystem *system)
+{
+	auto it = std::find(debrisSystems.begin(), debrisSystems.end(), system);
+	if (it != debrisSystems.end())
+		debrisSystems.erase(it);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Each field runs over its bodies in one batch. A field limited to a
+// region gets the bodies whose proxies overlap it, cut down to the ones
+// centered inside, so it never walks the whole list. The proxies are
+// brought up to date first with the velocities of the step.
+///////////////////////////////////////////////////////////////////////////////
+void World::ApplyForceFields(float deltaTime)
+{
+	const int dynamicCount = static_cast<int>(dynamicBodies.size());
+	if (globalForces.force.x != 0.0f || globalForces.force.y != 0.0f || globalForces.torque != 0.0f)
+		globalForces.Apply(dynamicBodies.data(), dynamicCount);
+
+	bool isTreeUpdated = false;
+	for (const ForceField *field: forceFields) {
+		if (!field->IsRegionLimited()) {
+			field->Apply(dynamicBodies.data(), dynamicCount);
+			continue;
+		}
+
+		if (!isTreeUpdated) {
+			UpdateProxies(deltaTime);
+			UpdateTrees();
+			isTreeUpdated = true;
+		}
+
+		const AABB &region = field->GetRegion();
+		fieldBodies.clear();
+		dynamicTree.Query(region, [&](int index) {
+			Body *body = dynamicBodies[index];
+			if (region.Contains(body->position))
+				fieldBodies.push_back(body);
+			return true;
+		});
+		if (!fieldBodies.empty())
+			field->Apply(fieldBodies.data(), static_cast<int>(fieldBodies.size()));
+	}
 }
 
 void World::Update(float deltaTime)
@@ -60,73 +260,668 @@ void World::Update(float deltaTime)
     // Vector of penetration constraints
     std::vector<PenetrationConstraint> penetrations{};
     
-	for (auto& body: bodies) {
-		if (body->IsStatic()) continue;
-        
+	for (auto& body: dynamicBodies) {
 		// Apply gravity
 		body->AddForce(Vec2(0, body->gravityScale * (G * body->mass * PIXELS_PER_METER)));
+	}
 
-		// Apply forces
-		for (Vec2& force: forces) {
-			body->AddForce(force);
-		}
-
-		// Apply torques
-		for (float& torque: torques) {
-			body->AddTorque(torque);
-		}
+	// Apply forces and torques
+	ApplyForceFields(deltaTime);
+	for (auto& network: springNetworks) {
+		network->ApplyForces();
 	}
 
     // Integrate all the forces
-    for (auto& body: bodies) {
+    for (auto& body: dynamicBodies) {
         body->IntegrateForces(deltaTime);
     }
 
     // Check penetrations
-    CheckCollisions(penetrations);
+    CheckCollisions(penetrations, deltaTime);
 
-    // Solve all constraints
-    for (auto& constraint: constraints) {
+    // Solve all constraints, the direct solver runs last in each iteration so the tree joints end up exact
+    if (isJointSolverDirect)
+        jointSolver.PreSolve(constraints, iterativeConstraints, deltaTime);
+    else
+        iterativeConstraints = constraints;
+    for (auto& constraint: iterativeConstraints) {
         constraint->PreSolve(deltaTime);
     }
     for (auto& pConstraint: penetrations) {
+        if (isJointSolverDirect)
+            pConstraint.SetInverseI(jointSolver.GetInverseI(pConstraint.a), jointSolver.GetInverseI(pConstraint.b));
         pConstraint.PreSolve(deltaTime);
     }
     for (int i = 0; i < 10; i++) {
-        for (auto& constraint: constraints)
+        for (auto& constraint: iterativeConstraints)
             constraint->Solve();
         for (auto& pConstraint: penetrations)
             pConstraint.Solve();
+        if (isJointSolverDirect)
+            jointSolver.Solve();
     }
-    for (auto& constraint: constraints) {
+    for (auto& constraint: iterativeConstraints) {
         constraint->PostSolve();
     }
     for (auto& pConstraint: penetrations) {
         pConstraint.PostSolve();
     }
 
-    // Integrate all the velocities
-    for (auto& body: bodies) {
+    // Integrate all the velocities, bullets are swept against the rest of the world instead (sensors have nothing to stop them)
+    bool hasBullets = false;
+    for (auto& body: dynamicBodies) {
+        if (body->isBullet && !body->isSensor) {
+            hasBullets = true;
+            continue;
+        }
         body->IntegrateVelocities(deltaTime);
     }
+    if (hasBullets) {
+        // The dynamic tree is brought to where the bodies ended the step, the bullets query it
+        areProxiesStale = true;
+        UpdateTrees();
+        for (auto& body: dynamicBodies) {
+            if (!body->isBullet || body->isSensor) continue;
+            SolveTimeOfImpact(body, deltaTime);
+        }
+    }
+
+    // Joints close the drift left by the integration, stopping once all of them are within tolerance
+    for (int i = 0; i < POSITION_ITERATIONS; i++) {
+        bool isSolved = true;
+        for (auto& constraint: iterativeConstraints)
+            isSolved = constraint->SolvePosition() && isSolved;
+        if (isSolved) break;
+    }
+
+    // Tree joints close the gaps left by the integration
+    if (isJointSolverDirect)
+        jointSolver.SolvePositions();
+
+    // Compliant springs work on the integrated positions
+    for (auto& network: springNetworks) {
+        network->SolvePositions(deltaTime);
+    }
+
+    // Impulses of the contacts, in the order of their pre solve events
+    for (auto& pConstraint: penetrations) {
+        const ContactPreSolveEvent& preSolve = contactEvents.preSolve[contactEvents.postSolve.size()];
+        ContactPostSolveEvent postSolve;
+        postSolve.a = preSolve.a;
+        postSolve.b = preSolve.b;
+        postSolve.point = preSolve.point;
+        postSolve.normalImpulse = pConstraint.GetNormalImpulse();
+        postSolve.tangentImpulse = pConstraint.GetTangentImpulse();
+        contactEvents.postSolve.push_back(postSolve);
+    }
+
+    areProxiesStale = true;
+
+    // Particles collide with the bodies where they ended the step
+    for (auto& system: softBodySystems) {
+        system->Step(deltaTime, Vec2(0, G * PIXELS_PER_METER), *this);
+    }
+    for (auto& system: fluidSystems) {
+        system->Step(deltaTime, Vec2(0, G * PIXELS_PER_METER), *this);
+    }
+    for (auto& system: debrisSystems) {
+        system->Step(deltaTime, Vec2(0, G * PIXELS_PER_METER), *this);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Moves a bullet through the step in sub-steps, stopping at each time of impact
+// against static and non-bullet bodies (at their final position) to resolve the
+// contact before moving on with the remaining time. After MAX_TOI_SUBSTEPS
+// impacts the bullet only moves up to the next one, the time left after it is
+// dropped and the discrete contacts of the next step take over.
+///////////////////////////////////////////////////////////////////////////////
+void World::SolveTimeOfImpact(Body *bullet, float deltaTime)
+{
+    float remaining = deltaTime;
+    for (int substep = 0; ; substep++) {
+        const Vec2 translation = bullet->velocity * remaining;
+        const float rotation = bullet->angularVelocity * remaining;
+
+        // Bounds of the bullet over the rest of the step, padded for the rotation
+        const AABB box = bullet->shape->GetAABB();
+        const Vec2 padding = Vec2(1.0f, 1.0f) * (std::abs(rotation) * (box.max - box.min).Magnitude());
+        const AABB sweep = box.Union(AABB(box.min + translation, box.max + translation));
+        const AABB paddedSweep(sweep.min - padding, sweep.max + padding);
+
+        float fraction = 1.0f;
+        Body *hitBody = nullptr;
+        DistanceOutput hit;
+        auto sweepAgainst = [&](Body *other, const Shape &shape) {
+            float otherFraction;
+            DistanceOutput output;
+            if (CollisionDetection::TimeOfImpact(bullet, translation, rotation, shape, otherFraction, output) && otherFraction < fraction) {
+                fraction = otherFraction;
+                hitBody = other;
+                hit = output;
+            }
+        };
+
+        staticTree.Query(paddedSweep, [&](int index) {
+            Body *other = staticBodies[index];
+            if (other->isSensor || !ShouldCollide(other, bullet)) return true;
+            if (other->shape->GetType() != ShapeType::CHAIN) {
+                sweepAgainst(other, *other->shape);
+                return true;
+            }
+
+            // Chains are swept segment by segment, only from their front side
+            const ChainShape *chain = static_cast<ChainShape *>(other->shape);
+            chain->tree.Query(paddedSweep, [&](int segmentIndex) {
+                const ChainSegment segment = chain->GetSegment(segmentIndex);
+                if ((bullet->position - segment.v1).Dot(segment.normal) < 0.0f) return true;
+
+                sweepAgainst(other, chain->GetSegmentShape(segmentIndex));
+                return true;
+            });
+            return true;
+        });
+        dynamicTree.Query(paddedSweep, [&](int index) {
+            Body *other = dynamicBodies[index];
+            if (other->isBullet || other->isSensor || !other->shape->GetAABB().Overlaps(paddedSweep) || !ShouldCollide(other, bullet)) return true;
+            sweepAgainst(other, *other->shape);
+            return true;
+        });
+
+        if (!hitBody) {
+            bullet->IntegrateVelocities(remaining);
+            return;
+        }
+
+        // Advance to the impact and resolve it as a regular contact
+        bullet->IntegrateVelocities(remaining * fraction);
+        remaining -= remaining * fraction;
+        if (substep == MAX_TOI_SUBSTEPS) return;
+
+        // Anchored on the same point, the bodies touch there rather than leaving a speculative gap
+        const Vec2 normal = (hit.pointA - hit.pointB).UnitVector();
+        const Vec2 point = (hit.pointA + hit.pointB) * 0.5f;
+        PenetrationConstraint contact(hitBody, bullet, point, point, normal);
+        contact.PreSolve(deltaTime);
+        for (int i = 0; i < 10; i++)
+            contact.Solve();
+        contact.PostSolve();
+    }
+}
+
+void World::RebuildStaticTree()
+{
+    // Static bodies don't move, so their boxes stay valid until the set changes
+    std::vector<AABB> boxes(staticBodies.size());
+    for (int i = 0; i < staticBodies.size(); i++)
+        boxes[i] = staticBodies[i]->shape->GetAABB();
+
+    staticTree.Build(boxes);
+    isStaticTreeDirty = false;
+}
+
+void World::RebuildDynamicTree()
+{
+    std::vector<AABB> boxes(proxies.size());
+    for (int i = 0; i < proxies.size(); i++)
+        boxes[i] = proxies[i].box;
+
+    dynamicTree.Build(boxes);
+    isDynamicTreeDirty = false;
+}
+
+void World::UpdateProxies(float deltaTime)
+{
+    for (int i = 0; i < dynamicBodies.size(); i++) {
+        const Body *body = dynamicBodies[i];
+        Proxy &proxy = proxies[i];
+
+        const AABB box = body->shape->GetAABB();
+        const Vec2 displacement = body->velocity * deltaTime;
+        proxy.sweptBox = speculativeMargin > 0.0f ? box.Union(AABB(box.min + displacement, box.max + displacement)) : box;
+
+        // Static bodies get speculative contacts all around the body, so the proxy covers the margin too
+        const float margin = std::min(speculativeMargin, displacement.Magnitude());
+        const AABB reach(proxy.sweptBox.min - Vec2(margin, margin), proxy.sweptBox.max + Vec2(margin, margin));
+        if (proxy.box.Contains(reach)) continue;
+
+        proxy.box = AABB(reach.min - Vec2(PROXY_MARGIN, PROXY_MARGIN), reach.max + Vec2(PROXY_MARGIN, PROXY_MARGIN));
+        proxy.isMoved = true;
+        isDynamicTreeDirty = true;
+    }
+    areProxiesStale = false;
+}
+
+void World::UpdateTrees()
+{
+    if (areProxiesStale) UpdateProxies(0.0f);
+    if (isStaticTreeDirty) RebuildStaticTree();
+    if (isDynamicTreeDirty) RebuildDynamicTree();
+}
+
+const AABB &World::GetProxyBox(const Body *body) const
+{
+    return body->IsStatic() ? staticTree.GetItemBox(body->proxyIndex) : proxies[body->proxyIndex].box;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Only proxies that moved look for new partners, a pair that didn't
+// involve one of them can't have started overlapping. Pairs are kept
+// until their proxies separate, whether or not the bodies touch, or
+// until a filter change rules them out.
+///////////////////////////////////////////////////////////////////////////////
+void World::UpdatePairs()
+{
+    for (int i = static_cast<int>(pairs.size()) - 1; i >= 0; i--) {
+        ContactPair &pair = pairs[i];
+        const bool isFiltered = pair.isFilterStale && !ShouldCollide(pair.a, pair.b);
+        pair.isFilterStale = false;
+        if (!isFiltered && GetProxyBox(pair.a).Overlaps(GetProxyBox(pair.b))) continue;
+        RemovePair(i, true);
+    }
+
+    for (int i = 0; i < proxies.size(); i++) {
+        if (!proxies[i].isMoved) continue;
+
+        // Two moved proxies find each other twice, the lower index adds the pair
+        dynamicTree.Query(proxies[i].box, [&](int j) {
+            if (j == i || (proxies[j].isMoved && j < i)) return true;
+            AddPair(dynamicBodies[std::min(i, j)], dynamicBodies[std::max(i, j)]);
+            return true;
+        });
+        staticTree.Query(proxies[i].box, [&](int j) {
+            AddPair(staticBodies[j], dynamicBodies[i]);
+            return true;
+        });
+    }
+
+    for (Proxy &proxy: proxies)
+        proxy.isMoved = false;
+}
+
+void World::AddPair(Body *a, Body *b)
+{
+    if ((a->isSensor && b->isSensor) || !ShouldCollide(a, b)) return;
+
+    const BodyPair key = MakeBodyPair(a, b);
+    if (pairIndices.count(key)) return;
+
+    ContactPair pair;
+    pair.a = a;
+    pair.b = b;
+    pairIndices[key] = static_cast<int>(pairs.size());
+    pairs.push_back(pair);
+}
+
+void World::RemovePair(int index, bool isEndEventSent)
+{
+    const ContactPair &pair = pairs[index];
+    if (isEndEventSent && pair.isTouching)
+        AddPairEvent(pair, false, nullptr);
+    pairIndices.erase(MakeBodyPair(pair.a, pair.b));
+    CollisionDetection::ClearCache(pair.a, pair.b);
+
+    // The last pair takes the place of the removed one
+    if (index != pairs.size() - 1) {
+        pairs[index] = pairs.back();
+        const ContactPair &moved = pairs[index];
+        pairIndices[MakeBodyPair(moved.a, moved.b)] = index;
+    }
+    pairs.pop_back();
+}
+
+void World::AddPairEvent(const ContactPair &pair, bool isBegin, const Contact *contact)
+{
+    if (pair.a->isSensor || pair.b->isSensor) {
+        SensorEvent event;
+        event.sensor = pair.a->isSensor ? pair.a : pair.b;
+        event.visitor = pair.a->isSensor ? pair.b : pair.a;
+        (isBegin ? sensorEvents.begin : sensorEvents.end).push_back(event);
+        return;
+    }
+
+    if (!isBegin) {
+        ContactEndEvent event;
+        event.a = pair.a;
+        event.b = pair.b;
+        contactEvents.end.push_back(event);
+        return;
+    }
+
+    ContactBeginEvent event;
+    event.a = pair.a;
+    event.b = pair.b;
+    event.point = (contact->start + contact->end) * 0.5f;
+    event.normal = contact->normal;
+    contactEvents.begin.push_back(event);
+}
+
+bool World::ShouldCollide(const Body *a, const Body *b) const
+{
+    if (!a->ShouldCollide(*b)) return false;
+    return connectedPairs.empty() || !connectedPairs.count(MakeBodyPair(a, b));
+}
+
+void World::TouchProxy(Body *body)
+{
+    // Bodies outside the world have no proxy
+    if (body->proxyIndex < 0) return;
+
+    if (!body->IsStatic()) {
+        proxies[body->proxyIndex].isMoved = true;
+        return;
+    }
+
+    // Static bodies don't look for pairs, the dynamic ones around them do
+    UpdateTrees();
+    dynamicTree.Query(staticTree.GetItemBox(body->proxyIndex), [&](int index) {
+        proxies[index].isMoved = true;
+        return true;
+    });
+}
+
+void World::CheckCollisions(std::vector<PenetrationConstraint> &OutPenetrations, float deltaTime)
+{
+    CollisionDetection::ResetStats();
+
+    contactEvents.begin.clear();
+    contactEvents.end.clear();
+    contactEvents.preSolve.clear();
+    contactEvents.postSolve.clear();
+    sensorEvents.begin.clear();
+    sensorEvents.end.clear();
+
+    UpdateProxies(deltaTime);
+    UpdateTrees();
+    UpdatePairs();
+
+    auto getMargin = [&](const Vec2& relativeVelocity) {
+        return std::min(speculativeMargin, relativeVelocity.Magnitude() * deltaTime);
+    };
+
+    std::vector<Contact> contacts{};
+    for (ContactPair &pair: pairs) {
+        Body *a = pair.a;
+        Body *b = pair.b;
+
+        // Speculative contacts with static bodies always, between dynamic bodies only when their motion meets
+        float margin = 0.0f;
+        if (speculativeMargin > 0.0f) {
+            if (a->IsStatic())
+                margin = getMargin(b->velocity);
+            else if (proxies[a->proxyIndex].sweptBox.Overlaps(proxies[b->proxyIndex].sweptBox))
+                margin = getMargin(b->velocity - a->velocity);
+        }
+
+        const bool wasTouching = pair.isTouching;
+
+        // Sensors only track the overlap
+        if (a->isSensor || b->isSensor) {
+            pair.isTouching = CollisionDetection::IsOverlapping(a, b);
+            if (pair.isTouching != wasTouching)
+                AddPairEvent(pair, pair.isTouching, nullptr);
+            continue;
+        }
+
+        contacts.clear();
+        const bool isColliding = CollisionDetection::IsCollidingSpeculative(a, b, margin, contacts);
+
+        // Touching takes an actual contact, speculative ones are still apart
+        pair.isTouching = isColliding && std::any_of(contacts.begin(), contacts.end(), [](const Contact &contact) {
+            return contact.depth >= 0.0f;
+        });
+        if (pair.isTouching != wasTouching)
+            AddPairEvent(pair, pair.isTouching, pair.isTouching ? &contacts[0] : nullptr);
+        if (!isColliding) continue;
+
+        // Resolve the collision
+        for (auto &contact: contacts) {
+            PenetrationConstraint penetration(contact.a, contact.b, contact.start, contact.end, contact.normal);
+            OutPenetrations.push_back(penetration);
+
+            ContactPreSolveEvent event;
+            event.a = contact.a;
+            event.b = contact.b;
+            event.point = (contact.start + contact.end) * 0.5f;
+            event.normal = contact.normal;
+            event.depth = contact.depth;
+            contactEvents.preSolve.push_back(event);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Queries
+///////////////////////////////////////////////////////////////////////////////
+int World::QueryAABB(const AABB &box, Body **outBodies, int maxCount)
+{
+    UpdateTrees();
+
+    // The dynamic tree holds the enlarged proxies, their bodies are checked against their own bounds
+    int count = 0;
+    auto queryTree = [&](const BVH &tree, const std::vector<Body *> &treeBodies, bool isEnlarged) {
+        if (count >= maxCount) return;
+        tree.Query(box, [&](int index) {
+            Body *body = treeBodies[index];
+            if (!isEnlarged || body->shape->GetAABB().Overlaps(box))
+                outBodies[count++] = body;
+            return count < maxCount;
+        });
+    };
+
+    queryTree(staticTree, staticBodies, false);
+    queryTree(dynamicTree, dynamicBodies, true);
+    return count;
+}
+
+int World::QueryPoint(const Vec2 &point, Body **outBodies, int maxCount)
+{
+    UpdateTrees();
+
+    // The trees narrow it down to the boxes around the point, the shapes make the exact test
+    int count = 0;
+    const AABB box(point, point);
+    auto queryTree = [&](const BVH &tree, const std::vector<Body *> &treeBodies) {
+        if (count >= maxCount) return;
+        tree.Query(box, [&](int index) {
+            Body *body = treeBodies[index];
+            if (body->shape->TestPoint(point))
+                outBodies[count++] = body;
+            return count < maxCount;
+        });
+    };
+
+    queryTree(staticTree, staticBodies);
+    queryTree(dynamicTree, dynamicBodies);
+    return count;
+}
+
+void World::CastRay(const Vec2 &start, const Vec2 &end, const std::function<float(Body *, const RayCastOutput &)> &callback)
+{
+    UpdateTrees();
+
+    // Both trees share the max fraction, so hits in one clip the traversal of the other
+    float maxFraction = 1.0f;
+    auto castTree = [&](const BVH &tree, const std::vector<Body *> &treeBodies) {
+        tree.RayCast(start, end, maxFraction, [&](int index) {
+            Body *body = treeBodies[index];
+            if (body->isSensor) return maxFraction;
+
+            RayCastOutput output;
+            if (body->shape->RayCast(start, end, maxFraction, output))
+                maxFraction = callback(body, output);
+            return maxFraction;
+        });
+    };
+
+    castTree(staticTree, staticBodies);
+    if (maxFraction > 0.0f)
+        castTree(dynamicTree, dynamicBodies);
+}
+
+bool World::RayCast(const Vec2 &start, const Vec2 &end, RayCastHit &outHit)
+{
+    bool isHit = false;
+    CastRay(start, end, [&](Body *body, const RayCastOutput &output) {
+        isHit = true;
+        outHit.body = body;
+        outHit.normal = output.normal;
+        outHit.fraction = output.fraction;
+        return output.fraction;
+    });
+
+    if (isHit) outHit.point = start + (end - start) * outHit.fraction;
+    return isHit;
+}
+
+bool World::RayCastAny(const Vec2 &start, const Vec2 &end)
+{
+    bool isHit = false;
+    CastRay(start, end, [&](Body *body, const RayCastOutput &output) {
+        isHit = true;
+        return 0.0f;
+    });
+    return isHit;
+}
+
+void World::RayCastAll(const Vec2 &start, const Vec2 &end, const std::function<bool(const RayCastHit &)> &callback)
+{
+    CastRay(start, end, [&](Body *body, const RayCastOutput &output) {
+        RayCastHit hit;
+        hit.body = body;
+        hit.point = start + (end - start) * output.fraction;
+        hit.normal = output.normal;
+        hit.fraction = output.fraction;
+        return callback(hit) ? 1.0f : 0.0f;
+    });
+}
+
+void World::RayCastBatch(const std::vector<RayCastInput> &rays, std::vector<RayCastHit> &outHits, int threadCount)
+{
+    // Brought up to date first, the workers only read the trees
+    UpdateTrees();
+
+    const int rayCount = static_cast<int>(rays.size());
+    outHits.assign(rayCount, RayCastHit());
+
+    const int packetCount = (rayCount + BVH::PACKET_SIZE - 1) / BVH::PACKET_SIZE;
+    auto castPackets = [&](int first, int last) {
+        for (int packet = first; packet < last; packet++) {
+            const int start = packet * BVH::PACKET_SIZE;
+            CastRayPacket(rays.data() + start, std::min(BVH::PACKET_SIZE, rayCount - start), outHits.data() + start);
+        }
+    };
+
+    threadCount = std::max(1, std::min(threadCount, packetCount));
+    if (threadCount == 1) {
+        castPackets(0, packetCount);
+        return;
+    }
+
+    // Contiguous chunks of packets per thread, the calling thread takes the last one
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (int i = 0; i < threadCount - 1; i++)
+        workers.emplace_back(castPackets, packetCount * i / threadCount, packetCount * (i + 1) / threadCount);
+    castPackets(packetCount * (threadCount - 1) / threadCount, packetCount);
+
+    for (std::thread &worker : workers)
+        worker.join();
 }
 
-void World::CheckCollisions(std::vector<PenetrationConstraint> &OutPenetrations)
+void World::CastRayPacket(const RayCastInput *rays, int count, RayCastHit *outHits) const
 {
-    // Check all the bodies with all other bodies detecting collisions
-    for (int i = 0; i <= bodies.size() - 1; i++)
-        for (int j = i + 1; j < bodies.size(); j++) {
-            Body *a = bodies[i];
-            Body *b = bodies[j];
+    // Lanes past count are padded with a zero max fraction, which leaves them out
+    Vec2 starts[BVH::PACKET_SIZE];
+    Vec2 ends[BVH::PACKET_SIZE];
+    float maxFractions[BVH::PACKET_SIZE];
+    for (int i = 0; i < BVH::PACKET_SIZE; i++) {
+        starts[i] = i < count ? rays[i].start : Vec2();
+        ends[i] = i < count ? rays[i].end : Vec2();
+        maxFractions[i] = i < count ? 1.0f : 0.0f;
+    }
+
+    auto castTree = [&](const BVH &tree, const std::vector<Body *> &treeBodies) {
+        tree.RayCastPacket(starts, ends, maxFractions, [&](int index, int laneMask) {
+            Body *body = treeBodies[index];
+            if (body->isSensor) return;
 
-            std::vector<Contact> contacts{};
-            if (!CollisionDetection::IsColliding(a, b, contacts)) continue;
+            RayCastOutput outputs[BVH::PACKET_SIZE];
+            const int hitMask = body->shape->RayCastPacket(starts, ends, maxFractions, laneMask, outputs);
 
-            // Resolve the collision
-            for (auto &contact: contacts) {
-                PenetrationConstraint penetration(contact.a, contact.b, contact.start, contact.end, contact.normal);
-                OutPenetrations.push_back(penetration);
+            for (int i = 0; i < count; i++) {
+                if (!(hitMask & (1 << i))) continue;
+                maxFractions[i] = outputs[i].fraction;
+                outHits[i].body = body;
+                outHits[i].normal = outputs[i].normal;
+                outHits[i].fraction = outputs[i].fraction;
             }
+        });
+    };
+
+    castTree(staticTree, staticBodies);
+    castTree(dynamicTree, dynamicBodies);
+
+    for (int i = 0; i < count; i++) {
+        if (outHits[i].body)
+            outHits[i].point = rays[i].start + (rays[i].end - rays[i].start) * outHits[i].fraction;
+    }
+}
+
+bool World::ShapeCast(const Shape &shape, const Vec2 &position, float angle, const Vec2 &translation, RayCastHit &outHit)
+{
+    UpdateTrees();
+
+    Shape *castShape = shape.Clone();
+    castShape->UpdateVertices(angle, position);
+
+    const AABB box = castShape->GetAABB();
+    const AABB sweep = box.Union(AABB(box.min + translation, box.max + translation));
+
+    bool isHit = false;
+    auto castAgainst = [&](Body *body, const Shape &target) {
+        if (body->isSensor) return;
+
+        DistanceOutput output;
+        float fraction = 0.0f;
+
+        // Starting overlapped is a hit right away
+        GJK::Distance(*castShape, target, output);
+        if (output.distance > 0.0f &&
+            !CollisionDetection::TimeOfImpact(*castShape, position, angle, translation, 0.0f, target, fraction, output))
+            return;
+        if (isHit && fraction >= outHit.fraction) return;
+
+        isHit = true;
+        outHit.body = body;
+        outHit.point = output.pointB;
+        outHit.normal = (output.pointA - output.pointB).UnitVector();
+        outHit.fraction = fraction;
+    };
+
+    staticTree.Query(sweep, [&](int index) {
+        Body *body = staticBodies[index];
+        if (body->shape->GetType() != ShapeType::CHAIN) {
+            castAgainst(body, *body->shape);
+            return true;
         }
 
+        // Chains are cast against segment by segment, only from their front side
+        const ChainShape *chain = static_cast<ChainShape *>(body->shape);
+        chain->tree.Query(sweep, [&](int segmentIndex) {
+            const ChainSegment segment = chain->GetSegment(segmentIndex);
+            if ((position - segment.v1).Dot(segment.normal) < 0.0f) return true;
+
+            castAgainst(body, chain->GetSegmentShape(segmentIndex));
+            return true;
+        });
+        return true;
+    });
+    dynamicTree.Query(sweep, [&](int index) {
+        castAgainst(dynamicBodies[index], *dynamicBodies[index]->shape);
+        return true;
+    });
+
+    delete castShape;
+    return isHit;
 }
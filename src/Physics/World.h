@@ -1,11 +1,96 @@
 #ifndef WORLD_H
 #define WORLD_H
 
+#include <functional>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Body.h"
+#include "BVH.h"
 #include "Contact.h"
 #include "Constraint.h"
+#include "DebrisSystem.h"
+#include "FluidSystem.h"
+#include "ForceField.h"
+#include "JointTreeSolver.h"
+#include "SoftBodySystem.h"
+#include "SpringNetwork.h"
+
+// Body hit by a ray or shape cast
+struct RayCastHit
+{
+	Body* body = nullptr;
+	Vec2 point{};			// Hit point on the body surface
+	Vec2 normal{};			// Surface normal at the hit point
+	float fraction = 0.0f;	// Fraction of the cast where the hit happens
+};
+
+// Ray of a batched cast
+struct RayCastInput
+{
+	Vec2 start{};
+	Vec2 end{};
+};
+
+// Pair of bodies that started touching in the last step, at their first contact point
+struct ContactBeginEvent
+{
+	Body* a = nullptr;
+	Body* b = nullptr;
+	Vec2 point{};
+	Vec2 normal{};			// From a to b
+};
+
+// Pair of bodies that stopped touching in the last step
+struct ContactEndEvent
+{
+	Body* a = nullptr;
+	Body* b = nullptr;
+};
+
+// Contact point handed to the solver
+struct ContactPreSolveEvent
+{
+	Body* a = nullptr;
+	Body* b = nullptr;
+	Vec2 point{};
+	Vec2 normal{};			// From a to b
+	float depth = 0.0f;		// Negative for speculative contacts, which are still apart
+};
+
+// Impulses the solver applied at a contact point
+struct ContactPostSolveEvent
+{
+	Body* a = nullptr;
+	Body* b = nullptr;
+	Vec2 point{};
+	float normalImpulse = 0.0f;
+	float tangentImpulse = 0.0f;
+};
+
+// Contact events of the last step, batched by kind. Pre and post solve events are in the same order
+struct ContactEvents
+{
+	std::vector<ContactBeginEvent> begin;
+	std::vector<ContactEndEvent> end;
+	std::vector<ContactPreSolveEvent> preSolve;
+	std::vector<ContactPostSolveEvent> postSolve;
+};
+
+// Sensor body and the body that started or stopped overlapping it
+struct SensorEvent
+{
+	Body* sensor = nullptr;
+	Body* visitor = nullptr;
+};
+
+// Sensor overlaps of the last step
+struct SensorEvents
+{
+	std::vector<SensorEvent> begin;
+	std::vector<SensorEvent> end;
+};
 
 class World
 {
@@ -15,27 +100,208 @@ public:
 	~World();
 
 public:
-	inline std::vector<Body*>& GetBodies() { return bodies; }
+	inline const std::vector<Body*>& GetBodies() const { return bodies; }
     inline std::vector<Constraint*>& GetConstraints() { return constraints; }
 	
 	void AddBody(Body* body);
+    // Bodies connected by a constraint don't collide with each other
     void AddConstraint(Constraint* constraint);
     void RemoveConstraint(Constraint* constraint);
 	void RemoveBody(Body* body);
+
+	// Re-evaluate the pairs of a body after changing its category, mask or group
+	void Refilter(Body* body);
+
+	// Force and torque on every dynamic body, summed into a uniform field applied before the others
 	void AddForce(const Vec2& force);
 	void AddTorque(float torque);
+
+	// Fields are applied to the dynamic bodies every step and deleted with the world.
+	// Region limited fields only visit the bodies the broadphase finds in their region
+	void AddForceField(ForceField* field);
+	void RemoveForceField(ForceField* field);
+	inline const std::vector<ForceField*>& GetForceFields() const { return forceFields; }
+
+	// Networks are stepped with the world and deleted with it, their bodies must be added to the world too
+	void AddSpringNetwork(SpringNetwork* network);
+	void RemoveSpringNetwork(SpringNetwork* network);
+	inline const std::vector<SpringNetwork*>& GetSpringNetworks() const { return springNetworks; }
+
+	// Particle systems are stepped after the bodies, in their own substeps, and deleted with the world
+	void AddSoftBodySystem(SoftBodySystem* system);
+	void RemoveSoftBodySystem(SoftBodySystem* system);
+	inline const std::vector<SoftBodySystem*>& GetSoftBodySystems() const { return softBodySystems; }
+
+	// Fluids are stepped after the bodies, which take the push of the particles on the next step. Deleted with the world
+	void AddFluidSystem(FluidSystem* system);
+	void RemoveFluidSystem(FluidSystem* system);
+	inline const std::vector<FluidSystem*>& GetFluidSystems() const { return fluidSystems; }
+
+	// Debris bounces off the bodies without moving them, stepped last and deleted with the world
+	void AddDebrisSystem(DebrisSystem* system);
+	void RemoveDebrisSystem(DebrisSystem* system);
+	inline const std::vector<DebrisSystem*>& GetDebrisSystems() const { return debrisSystems; }
+
+	// Joints of bodies connected as a tree (chains, bridges) are solved exactly instead of iteratively,
+	// joints of bodies with a loop between them stay iterative
+	inline void SetDirectJointSolver(bool isEnabled) { isJointSolverDirect = isEnabled; }
+	inline bool IsDirectJointSolverEnabled() const { return isJointSolverDirect; }
+
+	// Distance under which separated shapes already get a contact, scaled down by the relative velocity of the pair.
+	// Zero disables speculative contacts.
+	inline void SetSpeculativeMargin(float margin) { speculativeMargin = margin; }
+	inline float GetSpeculativeMargin() const { return speculativeMargin; }
+
+	// Events of the last step, valid until the next one. Pairs of a removed body end without an event
+	inline const ContactEvents& GetContactEvents() const { return contactEvents; }
+	inline const SensorEvents& GetSensorEvents() const { return sensorEvents; }
 	
 	void Update(float deltaTime);
 	
-	void CheckCollisions(std::vector<PenetrationConstraint> &OutPenetrations);
+	void CheckCollisions(std::vector<PenetrationConstraint> &OutPenetrations, float deltaTime);
+
+	// Bodies whose bounding box overlaps the box, written to outBodies up to maxCount. Returns how many were written
+	int QueryAABB(const AABB& box, Body** outBodies, int maxCount);
+
+	// Bodies whose shape contains the point, written to outBodies up to maxCount. Returns how many were written
+	int QueryPoint(const Vec2& point, Body** outBodies, int maxCount);
+
+	// Ray and shape casts pass through sensor bodies, a trigger zone doesn't block line of sight.
+	// Use QueryAABB or QueryPoint to find sensors
+
+	// Closest body hit by the ray start -> end
+	bool RayCast(const Vec2& start, const Vec2& end, RayCastHit& outHit);
+
+	// Whether the ray hits anything, stops at the first hit found (line of sight checks)
+	bool RayCastAny(const Vec2& start, const Vec2& end);
+
+	// Every body hit by the ray in no particular order, the callback returns false to stop
+	void RayCastAll(const Vec2& start, const Vec2& end, const std::function<bool(const RayCastHit&)>& callback);
+
+	// Closest hit of every ray, traced through the broadphase in packets and split over threadCount threads.
+	// outHits[i].body is null when ray i misses. Neighbouring rays should be close in direction, like a sensor fan
+	void RayCastBatch(const std::vector<RayCastInput>& rays, std::vector<RayCastHit>& outHits, int threadCount = 1);
+
+	// First body hit by a convex shape at (position, angle) moved by translation, stopping just short of contact.
+	// A shape that starts overlapping reports fraction 0 with a zero normal
+	bool ShapeCast(const Shape& shape, const Vec2& position, float angle, const Vec2& translation, RayCastHit& outHit);
 	
 private:
+	// Impacts resolved per bullet and step, the bullet then stops at the next one until the next step
+	static constexpr int MAX_TOI_SUBSTEPS = 8;
+	static constexpr int POSITION_ITERATIONS = 3;
+
+	// How far the proxy boxes reach past the bodies, in pixels
+	static constexpr float PROXY_MARGIN = 5.0f;
+
 	float G = 9.8f;
+	float speculativeMargin = 0.0f;
+	bool isJointSolverDirect = false;
 	
 	std::vector<Body*> bodies = std::vector<Body*>();
+
+	// Bodies partitioned by mobility, static ones are only tested against dynamic ones
+	std::vector<Body*> dynamicBodies = std::vector<Body*>();
+	std::vector<Body*> staticBodies = std::vector<Body*>();
+
+	// Broadphase over the static bodies, rebuilt only when a static body is added or removed
+	BVH staticTree;
+	bool isStaticTreeDirty = false;
+
+	// Broadphase proxy of a dynamic body, its box is enlarged so small moves keep the same pairs
+	struct Proxy {
+		AABB box{};				// Enlarged bounds, the dynamic tree is built from these
+		AABB sweptBox{};		// Bounds over the step, for the speculative margin
+		bool isMoved = true;	// Box replaced since the pairs were last updated
+	};
+
+	// Proxies of the dynamic bodies, in the same order
+	std::vector<Proxy> proxies = std::vector<Proxy>();
+	bool areProxiesStale = false;
+
+	// Broadphase over the dynamic proxies, rebuilt lazily when one of them moves
+	BVH dynamicTree;
+	bool isDynamicTreeDirty = true;
+
+	// Bodies whose proxies overlap, kept across steps. a is the static body of a mixed pair
+	struct ContactPair {
+		Body* a = nullptr;
+		Body* b = nullptr;
+		bool isTouching = false;		// Overlapping for a sensor pair
+		bool isFilterStale = false;		// Filter or constraints of a body changed, check it again
+	};
+
+	typedef std::pair<const Body*, const Body*> BodyPair;
+
+	struct BodyPairHash {
+		std::size_t operator()(const BodyPair& pair) const {
+			const std::size_t h1 = std::hash<const Body*>()(pair.first);
+			const std::size_t h2 = std::hash<const Body*>()(pair.second);
+			return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
+		}
+	};
+
+	static BodyPair MakeBodyPair(const Body* a, const Body* b) { return a < b ? BodyPair(a, b) : BodyPair(b, a); }
+
+	std::vector<ContactPair> pairs = std::vector<ContactPair>();
+	std::unordered_map<BodyPair, int, BodyPairHash> pairIndices;
+
+	// Number of constraints between two bodies, connected bodies never get a pair
+	std::unordered_map<BodyPair, int, BodyPairHash> connectedPairs;
+
+	ContactEvents contactEvents;
+	SensorEvents sensorEvents;
+
+	// Event of a pair that starts or stops touching
+	void AddPairEvent(const ContactPair& pair, bool isBegin, const Contact* contact);
+
     std::vector<Constraint*> constraints = std::vector<Constraint*>();
-	std::vector<Vec2> forces = std::vector<Vec2>();
-	std::vector<float> torques = std::vector<float>();
+
+	// Direct solver of the tree shaped joints and the constraints left to the iterations
+	JointTreeSolver jointSolver;
+	std::vector<Constraint*> iterativeConstraints = std::vector<Constraint*>();
+
+	UniformForceField globalForces;
+	std::vector<ForceField*> forceFields = std::vector<ForceField*>();
+
+	std::vector<SpringNetwork*> springNetworks = std::vector<SpringNetwork*>();
+	std::vector<SoftBodySystem*> softBodySystems = std::vector<SoftBodySystem*>();
+	std::vector<FluidSystem*> fluidSystems = std::vector<FluidSystem*>();
+	std::vector<DebrisSystem*> debrisSystems = std::vector<DebrisSystem*>();
+
+	// Bodies of the region limited field being applied, reused between fields and steps
+	std::vector<Body*> fieldBodies = std::vector<Body*>();
+
+	void ApplyForceFields(float deltaTime);
+
+	void RebuildStaticTree();
+	void RebuildDynamicTree();
+
+	// Enlarge the proxies of the bodies that left them, bounds swept over deltaTime
+	void UpdateProxies(float deltaTime);
+
+	// Proxies and trees brought up to date for the queries
+	void UpdateTrees();
+
+	// Drop the pairs whose proxies stopped overlapping and add the new ones of the moved proxies
+	void UpdatePairs();
+	void AddPair(Body* a, Body* b);
+	void RemovePair(int index, bool isEndEventSent);
+	const AABB& GetProxyBox(const Body* body) const;
+
+	// Filter bits, groups and constraints, checked before any shape is looked at
+	bool ShouldCollide(const Body* a, const Body* b) const;
+
+	// Make the pairs of a body be searched again on the next update
+	void TouchProxy(Body* body);
+	void SolveTimeOfImpact(Body* bullet, float deltaTime);
+
+	// Calls callback(body, output) for every body the ray hits within the current max fraction,
+	// the callback returns the new max fraction (zero stops the cast)
+	void CastRay(const Vec2& start, const Vec2& end, const std::function<float(Body*, const RayCastOutput&)>& callback);
+
+	// Closest hits of up to BVH::PACKET_SIZE rays, traversing the trees once for all of them
+	void CastRayPacket(const RayCastInput* rays, int count, RayCastHit* outHits) const;
 };
 
 